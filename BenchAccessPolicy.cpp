@@ -0,0 +1,64 @@
+// BenchAccessPolicy.cpp
+
+#include "Benchmark.hpp"
+#include "access_policy.hpp"
+#include "shared_ptr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace
+{
+    constexpr std::size_t ELEMENTS = 1 << 20;
+    constexpr std::size_t ROUNDS = 200;
+
+    // The loop bound comes from the caller, as in most inner loops, so the
+    // bounds check cannot be proved redundant from size()
+    template <typename Access>
+    std::uint32_t sum(const usu::shared_ptr<std::uint32_t[]>& values, std::size_t count)
+    {
+        std::uint32_t total = 0;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            total += values.element<Access>(i);
+        }
+        return total;
+    }
+
+    template <typename Access>
+    void timeSum(const std::string& label, const usu::shared_ptr<std::uint32_t[]>& values)
+    {
+        std::uint32_t total = 0;
+        double ns = bench::timeOp(label, ROUNDS, [&]
+                                  { total += sum<Access>(values, ELEMENTS); });
+        bench::doNotOptimize(total);
+        bench::report(label + " per element", ns / ELEMENTS, "ns");
+    }
+} // namespace
+
+BENCHMARK(AccessPolicy, IndexLoop)
+{
+    auto values = usu::make_shared_array<std::uint32_t>(ELEMENTS, 64);
+    for (std::size_t i = 0; i < ELEMENTS; i++)
+    {
+        values[i] = static_cast<std::uint32_t>(i);
+    }
+
+    timeSum<usu::checked_access>("element<checked_access>", values);
+    // Checks only while NDEBUG is unset; with it set this matches unchecked
+    timeSum<usu::assert_access>("element<assert_access>", values);
+    timeSum<usu::unchecked_access>("element<unchecked_access>", values);
+
+    std::uint32_t total = 0;
+    const std::uint32_t* raw = values.get();
+    double ns = bench::timeOp("raw pointer", ROUNDS, [&]
+                              {
+                                  for (std::size_t i = 0; i < ELEMENTS; i++)
+                                  {
+                                      total += raw[i];
+                                  }
+                              });
+    bench::doNotOptimize(total);
+    bench::report("raw pointer per element", ns / ELEMENTS, "ns");
+}
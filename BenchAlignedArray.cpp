@@ -0,0 +1,112 @@
+// BenchAlignedArray.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace
+{
+    constexpr std::size_t BUFFER_BYTES = 64 * 1024 * 1024;
+    constexpr std::size_t ELEMENTS = BUFFER_BYTES / sizeof(std::uint32_t);
+    constexpr std::size_t ROUNDS = 10;
+
+    // Plain loop the compiler turns into vector adds; the aligned variant lets
+    // it use aligned loads without a peeling prologue
+    template <std::size_t Alignment>
+    std::uint32_t sum(const std::uint32_t* values, std::size_t count)
+    {
+        const std::uint32_t* aligned = std::assume_aligned<Alignment>(values);
+        std::uint32_t total = 0;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            total += aligned[i];
+        }
+        return total;
+    }
+
+    template <std::size_t Alignment>
+    void timeSum(const std::string& label, const std::uint32_t* values)
+    {
+        std::uint32_t total = 0;
+        double ns = bench::timeOp(label, ROUNDS, [&]
+                                  { total += sum<Alignment>(values, ELEMENTS); });
+        bench::doNotOptimize(total);
+        bench::report(label + " bandwidth", static_cast<double>(BUFFER_BYTES) / ns, "GB/s");
+    }
+} // namespace
+
+BENCHMARK(AlignedArray, Allocate64MB)
+{
+    bench::timeOp("shared_ptr(new T[n]())", ROUNDS, []
+                  {
+                      usu::shared_ptr<std::uint32_t[]> buffer(new std::uint32_t[ELEMENTS](), ELEMENTS);
+                      bench::doNotOptimize(buffer.get());
+                  });
+    bench::timeOp("make_shared_array<T>(n)", ROUNDS, []
+                  {
+                      auto buffer = usu::make_shared_array<std::uint32_t>(ELEMENTS, 64);
+                      bench::doNotOptimize(buffer.get());
+                  });
+    bench::timeOp("make_shared_for_overwrite<T[]>(n)", ROUNDS, []
+                  {
+                      auto buffer = usu::make_shared_for_overwrite<std::uint32_t[]>(ELEMENTS, 64);
+                      bench::doNotOptimize(buffer.get());
+                  });
+    bench::timeOp("std::make_shared_for_overwrite<T[]>(n)", ROUNDS, []
+                  {
+                      auto buffer = std::make_shared_for_overwrite<std::uint32_t[]>(ELEMENTS);
+                      bench::doNotOptimize(buffer.get());
+                  });
+    bench::timeOp("make_unique_array<T>(n)", ROUNDS, []
+                  {
+                      auto buffer = usu::make_unique_array<std::uint32_t>(ELEMENTS, 64);
+                      bench::doNotOptimize(buffer.get());
+                  });
+    bench::timeOp("make_unique_for_overwrite<T[]>(n)", ROUNDS, []
+                  {
+                      auto buffer = usu::make_unique_for_overwrite<std::uint32_t[]>(ELEMENTS, 64);
+                      bench::doNotOptimize(buffer.get());
+                  });
+}
+
+BENCHMARK(AlignedArray, Sum64MB)
+{
+    // One spare element so the same buffer can also be read from a misaligned start
+    auto buffer = usu::make_shared_for_overwrite<std::uint32_t[]>(ELEMENTS + 1, 64);
+    for (std::size_t i = 0; i < buffer.size(); i++)
+    {
+        buffer.get()[i] = static_cast<std::uint32_t>(i);
+    }
+    timeSum<64>("sum, 64-byte aligned", buffer.get());
+    timeSum<alignof(std::uint32_t)>("sum, 4 bytes past alignment", buffer.get() + 1);
+}
+
+// Handing each worker its chunk of a large buffer: a slice shares the parent's
+// block, where the alternative is copying the chunk into a buffer of its own
+BENCHMARK(AlignedArray, ChunkHandoff)
+{
+    constexpr std::size_t CHUNK = 16 * 1024;
+    constexpr std::size_t CHUNKS = ELEMENTS / CHUNK;
+    auto buffer = usu::make_shared_array<std::uint32_t>(ELEMENTS, 64);
+
+    std::size_t next = 0;
+    bench::timeOp("slice(offset, length)", CHUNKS, [&]
+                  {
+                      auto chunk = buffer.slice((next++ % CHUNKS) * CHUNK, CHUNK);
+                      bench::doNotOptimize(chunk.get());
+                  });
+    next = 0;
+    bench::timeOp("copy chunk", CHUNKS, [&]
+                  {
+                      auto chunk = usu::make_shared_for_overwrite<std::uint32_t[]>(CHUNK, 64);
+                      auto source = buffer.span().subspan((next++ % CHUNKS) * CHUNK, CHUNK);
+                      std::copy(source.begin(), source.end(), chunk.get());
+                      bench::doNotOptimize(chunk.get());
+                  });
+}
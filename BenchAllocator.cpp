@@ -0,0 +1,105 @@
+// BenchAllocator.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Node
+    {
+        explicit Node(int v) :
+            value(v)
+        {
+        }
+        int value;
+        int padding[7] = {};
+    };
+
+    constexpr std::size_t LIVE = 100'000;
+    constexpr std::size_t CHURN = 2'000'000;
+
+    // Keeps LIVE objects alive and replaces a random one on every step, the
+    // allocation pattern of a long-running service holding a working set
+    template <typename Ptr, typename Factory>
+    void churn(const std::string& label, Factory&& factory)
+    {
+        std::size_t rssBefore = bench::residentBytes();
+        std::vector<Ptr> live;
+        live.reserve(LIVE);
+        for (std::size_t i = 0; i < LIVE; i++)
+        {
+            live.emplace_back(factory(static_cast<int>(i)));
+        }
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<std::size_t> pick(0, LIVE - 1);
+        auto before = bench::allocationCount();
+        bench::timeOp(label + " replace", CHURN, [&]
+                      { live[pick(rng)] = factory(static_cast<int>(rng())); });
+        double perOp = static_cast<double>(bench::allocationCount() - before) / CHURN;
+        bench::report(label + " global allocations", perOp, "allocs/op");
+        bench::report(label + " RSS growth", (static_cast<double>(bench::residentBytes()) - static_cast<double>(rssBefore)) / (1024 * 1024), "MiB");
+    }
+
+    // Each thread churns its own working set
+    template <typename Factory>
+    void churnThreads(const std::string& label, Factory&& factory)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            std::vector<std::vector<usu::shared_ptr<Node>>> sets(threads);
+            std::vector<std::size_t> cursors(threads, 0);
+            bench::timeThreads(label, threads, CHURN / threads, [&](unsigned int t)
+                               {
+                                   auto& set = sets[t];
+                                   if (set.size() < LIVE / threads)
+                                   {
+                                       set.emplace_back(factory(0));
+                                   }
+                                   else
+                                   {
+                                       set[cursors[t]++ % set.size()] = factory(1);
+                                   }
+                               });
+        }
+    }
+
+    usu::shared_ptr<Node> globalShared(int value)
+    {
+        return usu::allocate_shared<Node>(std::allocator<Node>(), value);
+    }
+
+    usu::shared_ptr<Node> pooledShared(int value)
+    {
+        return usu::make_shared<Node>(value);
+    }
+
+    using pooled_unique = decltype(usu::allocate_unique<Node>(usu::pool_allocator<Node>(), 0));
+} // namespace
+
+BENCHMARK(Allocator, SharedChurn)
+{
+    churn<usu::shared_ptr<Node>>("global new", globalShared);
+    churn<usu::shared_ptr<Node>>("slab pool", pooledShared);
+}
+
+BENCHMARK(Allocator, UniqueChurn)
+{
+    churn<usu::unique_ptr<Node>>("make_unique", [](int value)
+                                 { return usu::make_unique<Node>(value); });
+    churn<pooled_unique>("allocate_unique (pool)", [](int value)
+                         { return usu::allocate_unique<Node>(usu::pool_allocator<Node>(), value); });
+}
+
+BENCHMARK(Allocator, ThreadedChurn)
+{
+    churnThreads("global new", globalShared);
+    churnThreads("slab pool", pooledShared);
+}
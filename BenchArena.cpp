@@ -0,0 +1,142 @@
+// BenchArena.cpp
+
+#include "Benchmark.hpp"
+#include "arena.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+namespace
+{
+    // 2^20 - 1 nodes, a full binary tree of depth 20
+    constexpr int DEPTH = 20;
+    constexpr std::size_t NODES = (std::size_t(1) << DEPTH) - 1;
+
+    struct SharedNode
+    {
+        usu::shared_ptr<SharedNode> left;
+        usu::shared_ptr<SharedNode> right;
+        long long value = 0;
+    };
+
+    struct UniqueNode
+    {
+        usu::unique_ptr<UniqueNode> left;
+        usu::unique_ptr<UniqueNode> right;
+        long long value = 0;
+    };
+
+    struct ArenaNode
+    {
+        usu::unique_ptr<ArenaNode, usu::arena_delete<ArenaNode>> left;
+        usu::unique_ptr<ArenaNode, usu::arena_delete<ArenaNode>> right;
+        long long value = 0;
+    };
+
+    template <typename Ptr, typename Factory>
+    Ptr build(int depth, Factory& factory)
+    {
+        Ptr node = factory();
+        node->value = depth;
+        if (depth > 1)
+        {
+            node->left = build<Ptr>(depth - 1, factory);
+            node->right = build<Ptr>(depth - 1, factory);
+        }
+        return node;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Builds the tree, then tears it down by dropping the root and calling finish
+    template <typename Ptr, typename Factory, typename Finish>
+    void buildAndTearDown(const std::string& label, Factory factory, Finish finish)
+    {
+        auto before = bench::allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        Ptr root = build<Ptr>(DEPTH, factory);
+        bench::report(label + " build", millisecondsSince(start), "ms");
+        bench::report(label + " global allocations", static_cast<double>(bench::allocationCount() - before) / NODES, "allocs/node");
+
+        start = std::chrono::steady_clock::now();
+        root = Ptr();
+        finish();
+        bench::report(label + " teardown", millisecondsSince(start), "ms");
+    }
+} // namespace
+
+BENCHMARK(Arena, SharedTree)
+{
+    buildAndTearDown<usu::shared_ptr<SharedNode>>(
+        "make_shared (slab pool)", []
+        { return usu::make_shared<SharedNode>(); },
+        [] {});
+
+    std::pmr::monotonic_buffer_resource monotonic;
+    buildAndTearDown<usu::shared_ptr<SharedNode>>(
+        "make_shared (pmr monotonic)", [&]
+        { return usu::make_shared<SharedNode>(&monotonic); },
+        [&]
+        { monotonic.release(); });
+
+    usu::arena withOwner(usu::arena_teardown::with_owner);
+    buildAndTearDown<usu::shared_ptr<SharedNode>>(
+        "make_shared (arena, with_owner)", [&]
+        { return usu::make_shared<SharedNode>(withOwner); },
+        [&]
+        { withOwner.reset(); });
+
+    // Owners still drop their counts, but no destructor runs until reset()
+    usu::arena atReset(usu::arena_teardown::at_reset);
+    buildAndTearDown<usu::shared_ptr<SharedNode>>(
+        "make_shared (arena, at_reset)", [&]
+        { return usu::make_shared<SharedNode>(atReset); },
+        [&]
+        { atReset.reset(); });
+}
+
+BENCHMARK(Arena, UniqueTree)
+{
+    buildAndTearDown<usu::unique_ptr<UniqueNode>>(
+        "make_unique", []
+        { return usu::make_unique<UniqueNode>(); },
+        [] {});
+
+    usu::arena withOwner(usu::arena_teardown::with_owner);
+    buildAndTearDown<usu::unique_ptr<ArenaNode, usu::arena_delete<ArenaNode>>>(
+        "make_unique (arena, with_owner)", [&]
+        { return usu::make_unique<ArenaNode>(withOwner); },
+        [&]
+        { withOwner.reset(); });
+
+    // Dropping the root touches nothing; reset() runs each destructor once
+    usu::arena atReset(usu::arena_teardown::at_reset);
+    buildAndTearDown<usu::unique_ptr<ArenaNode, usu::arena_delete<ArenaNode>>>(
+        "make_unique (arena, at_reset)", [&]
+        { return usu::make_unique<ArenaNode>(atReset); },
+        [&]
+        { atReset.reset(); });
+}
+
+// A trivially destructible payload is never tracked, so reset() only recycles memory
+BENCHMARK(Arena, TrivialPayload)
+{
+    usu::arena atReset(usu::arena_teardown::at_reset);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < NODES; i++)
+    {
+        auto node = usu::make_unique<long long>(atReset, static_cast<long long>(i));
+        bench::doNotOptimize(*node);
+    }
+    bench::report("make_unique<long long> x 1M (arena, at_reset)", millisecondsSince(start), "ms");
+    start = std::chrono::steady_clock::now();
+    atReset.reset();
+    bench::report("reset", millisecondsSince(start), "ms");
+}
@@ -0,0 +1,125 @@
+// BenchAtomicShared.cpp
+
+#include "Benchmark.hpp"
+#include "atomic_shared_ptr.hpp"
+#include "shared_ptr.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    struct Config
+    {
+        int routes[16] = {};
+    };
+
+    constexpr std::size_t READS = 200'000;
+    // Each reader times one in SAMPLE_EVERY loads to build a latency distribution
+    constexpr std::size_t SAMPLE_EVERY = 16;
+
+    // The baseline: a shared_ptr that readers copy under a mutex
+    class MutexGuarded
+    {
+      public:
+        usu::shared_ptr<Config> load()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return usu::shared_ptr<Config>(current);
+        }
+
+        void store(usu::shared_ptr<Config> desired)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = desired;
+        }
+
+      private:
+        std::mutex mutex;
+        usu::shared_ptr<Config> current = usu::make_shared<Config>();
+    };
+
+    // Runs readers against one writer that keeps publishing new snapshots
+    template <typename Holder>
+    void readersWithWriter(const std::string& label, Holder& holder, unsigned int readers)
+    {
+        std::atomic<bool> done{ false };
+        std::atomic<bool> go{ false };
+        std::thread writer([&]
+                           {
+                               while (!go.load())
+                               {
+                                   std::this_thread::yield();
+                               }
+                               while (!done.load(std::memory_order_relaxed))
+                               {
+                                   holder.store(usu::make_shared<Config>());
+                               }
+                           });
+
+        std::vector<std::vector<double>> samples(readers);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < readers; t++)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                                     samples[t].reserve(READS / SAMPLE_EVERY);
+                                     while (!go.load())
+                                     {
+                                         std::this_thread::yield();
+                                     }
+                                     long long sum = 0;
+                                     for (std::size_t i = 0; i < READS; i++)
+                                     {
+                                         if (i % SAMPLE_EVERY == 0)
+                                         {
+                                             auto start = std::chrono::steady_clock::now();
+                                             sum += holder.load()->routes[0];
+                                             auto elapsed = std::chrono::steady_clock::now() - start;
+                                             samples[t].push_back(std::chrono::duration<double, std::nano>(elapsed).count());
+                                         }
+                                         else
+                                         {
+                                             sum += holder.load()->routes[0];
+                                         }
+                                     }
+                                     bench::doNotOptimize(sum);
+                                 });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done = true;
+        writer.join();
+
+        std::vector<double> all;
+        for (auto& perThread : samples)
+        {
+            all.insert(all.end(), perThread.begin(), perThread.end());
+        }
+        std::string prefix = label + " @" + std::to_string(readers) + " readers";
+        bench::report(prefix + " reads", static_cast<double>(READS) * readers / seconds / 1e6, "Mops/s");
+        bench::reportPercentiles(prefix, std::move(all));
+    }
+} // namespace
+
+BENCHMARK(AtomicShared, ReadersPlusWriter)
+{
+    for (auto readers : bench::threadCounts())
+    {
+        usu::atomic_shared_ptr<Config> atomic(usu::make_shared<Config>());
+        readersWithWriter("atomic_shared_ptr", atomic, readers);
+
+        MutexGuarded guarded;
+        readersWithWriter("mutex + shared_ptr", guarded, readers);
+    }
+}
@@ -0,0 +1,73 @@
+// BenchBiasedShared.cpp
+
+#include "Benchmark.hpp"
+#include "biased_shared_ptr.hpp"
+#include "shared_ptr.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    constexpr std::size_t OPERATIONS = 2'000'000;
+
+    // Copy-then-destroy on the thread that made the object
+    template <typename Pointer>
+    void ownerOnly(const std::string& label, Pointer& source)
+    {
+        bench::timeOp(label + " owner copy/destroy", OPERATIONS, [&]
+                      {
+                          Pointer copy(source);
+                          bench::doNotOptimize(copy);
+                      });
+    }
+
+    // Splits the copies between the owner thread and one other thread, which
+    // works on a handle the owner gave it
+    template <typename Pointer>
+    void mixed(const std::string& label, Pointer& source, unsigned int foreignPercent)
+    {
+        std::size_t foreignOps = OPERATIONS * foreignPercent / 100;
+        std::size_t ownerOps = OPERATIONS - foreignOps;
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread foreign([escaped = source, foreignOps]() mutable
+                            {
+                                for (std::size_t i = 0; i < foreignOps; i++)
+                                {
+                                    Pointer copy(escaped);
+                                    bench::doNotOptimize(copy);
+                                }
+                            });
+        for (std::size_t i = 0; i < ownerOps; i++)
+        {
+            Pointer copy(source);
+            bench::doNotOptimize(copy);
+        }
+        foreign.join();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        bench::report(label + " " + std::to_string(100 - foreignPercent) + "/" + std::to_string(foreignPercent) + " owner/foreign",
+                      ns / OPERATIONS, "ns/op");
+    }
+} // namespace
+
+BENCHMARK(BiasedShared, OwnerThread)
+{
+    auto local = usu::make_shared<int, usu::thread_unsafe_counter>(1);
+    auto atomic = usu::make_shared<int>(1);
+    auto biased = usu::make_biased_shared<int>(1);
+    ownerOnly("usu::local_shared_ptr", local);
+    ownerOnly("usu::shared_ptr", atomic);
+    ownerOnly("usu::biased_shared_ptr", biased);
+}
+
+BENCHMARK(BiasedShared, OwnerForeignMix)
+{
+    for (unsigned int foreignPercent : { 0u, 10u, 50u, 90u })
+    {
+        auto atomic = usu::make_shared<int>(1);
+        mixed("usu::shared_ptr", atomic, foreignPercent);
+        auto biased = usu::make_biased_shared<int>(1);
+        mixed("usu::biased_shared_ptr", biased, foreignPercent);
+    }
+}
@@ -0,0 +1,157 @@
+// BenchCompact.cpp
+
+#include "Benchmark.hpp"
+#include "compact_ptr.hpp"
+#include "shared_ptr.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t NODES = 1 << 20;
+    constexpr std::size_t EDGES = 4;
+    constexpr std::size_t WALK_STEPS = 10'000'000;
+    constexpr std::size_t CHURN = 4'000'000;
+    constexpr std::size_t LIVE_PER_THREAD = 4096;
+
+    struct SharedNode
+    {
+        std::array<usu::shared_ptr<SharedNode>, EDGES> edges;
+        long long value = 0;
+    };
+
+    struct CompactNode
+    {
+        std::array<usu::compact_shared_ptr<CompactNode>, EDGES> edges;
+        long long value = 0;
+    };
+
+    std::uint64_t nextRandom(std::uint64_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Builds NODES nodes, each with EDGES edges to random nodes, then measures
+    // the memory it took and how fast the edges can be followed
+    template <typename Ptr, typename Make>
+    void graph(const std::string& label, Make&& make)
+    {
+        bench::report(label + " handle size", static_cast<double>(sizeof(Ptr)), "bytes");
+
+        std::size_t residentBefore = bench::residentBytes();
+        std::vector<Ptr> nodes;
+        nodes.reserve(NODES);
+        bench::timeOp(label + " build", NODES, [&]
+                      {
+                          nodes.push_back(make());
+                          nodes.back()->value = static_cast<long long>(nodes.size());
+                      });
+        std::uint64_t random = 0x2545F4914F6CDD1Dull;
+        for (auto& node : nodes)
+        {
+            for (auto& edge : node->edges)
+            {
+                edge = nodes[nextRandom(random) % NODES];
+            }
+        }
+        std::size_t residentAfter = bench::residentBytes();
+        if (residentAfter > residentBefore)
+        {
+            bench::report(label + " resident per node", static_cast<double>(residentAfter - residentBefore) / NODES, "bytes");
+        }
+
+        // Dependent loads from node to node, as in a search
+        long long sum = 0;
+        bench::timeOp(label + " random walk", WALK_STEPS, [&, node = nodes[0].get(), step = std::size_t{ 0 }]() mutable
+                      {
+                          sum += node->value;
+                          node = node->edges[step++ % EDGES].get();
+                      });
+
+        // Every edge of every node, in creation order
+        bench::timeOp(label + " edge sweep", NODES, [&, next = std::size_t{ 0 }]() mutable
+                      {
+                          for (auto& edge : nodes[next++]->edges)
+                          {
+                              sum += edge->value;
+                          }
+                      });
+        bench::doNotOptimize(sum);
+
+        // The same walk from several threads at once, each from its own start
+        for (auto threads : bench::threadCounts())
+        {
+            std::vector<decltype(nodes[0].get())> walkers;
+            for (unsigned int t = 0; t < threads; t++)
+            {
+                walkers.push_back(nodes[t * (NODES / threads)].get());
+            }
+            std::vector<long long> sums(threads, 0);
+            bench::timeThreads(label + " random walk", threads, WALK_STEPS / threads, [&](unsigned int t)
+                               {
+                                   sums[t] += walkers[t]->value;
+                                   walkers[t] = walkers[t]->edges[static_cast<std::size_t>(sums[t]) % EDGES].get();
+                               });
+            bench::doNotOptimize(sums);
+        }
+
+        // The edges make cycles, so they are cut before the nodes are dropped
+        for (auto& node : nodes)
+        {
+            for (auto& edge : node->edges)
+            {
+                edge = Ptr();
+            }
+        }
+        bench::timeOp(label + " destroy", NODES, [&]
+                      { nodes.pop_back(); });
+    }
+
+    // Each thread keeps its own working set and replaces one node of it per op,
+    // so every op makes a node and drops one while the other threads do the same
+    template <typename Ptr, typename Make>
+    void churnThreads(const std::string& label, Make&& make)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            std::vector<std::vector<Ptr>> sets(threads);
+            std::vector<std::size_t> cursors(threads, 0);
+            bench::timeThreads(label + " make and drop", threads, CHURN / threads, [&](unsigned int t)
+                               {
+                                   auto& set = sets[t];
+                                   if (set.size() < LIVE_PER_THREAD)
+                                   {
+                                       set.push_back(make());
+                                   }
+                                   else
+                                   {
+                                       set[cursors[t]++ % set.size()] = make();
+                                   }
+                               });
+        }
+    }
+} // namespace
+
+BENCHMARK(Compact, Graph)
+{
+    graph<usu::shared_ptr<SharedNode>>("shared_ptr", []
+                                       { return usu::make_shared<SharedNode>(); });
+    graph<usu::compact_shared_ptr<CompactNode>>("compact_shared_ptr", []
+                                                { return usu::make_compact_shared<CompactNode>(); });
+    bench::report("compact_shared_ptr arena reserved", static_cast<double>(usu::compact_arena<CompactNode>::global().reserved_bytes()) / (1 << 20), "MiB");
+}
+
+BENCHMARK(Compact, Threads)
+{
+    churnThreads<usu::shared_ptr<SharedNode>>("shared_ptr", []
+                                              { return usu::make_shared<SharedNode>(); });
+    churnThreads<usu::compact_shared_ptr<CompactNode>>("compact_shared_ptr", []
+                                                       { return usu::make_compact_shared<CompactNode>(); });
+}
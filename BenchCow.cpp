@@ -0,0 +1,75 @@
+// BenchCow.cpp
+
+#include "Benchmark.hpp"
+#include "cow_ptr.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t OPERATIONS = 200'000;
+    constexpr std::size_t HOLDERS = 256;
+
+    // The value passed around: a plain vector, copied whole by the deep copy side
+    using Value = std::vector<int>;
+
+    // Deep copies: every handoff copies the whole value
+    struct DeepCopy
+    {
+        static Value make(std::size_t elements) { return Value(elements, 1); }
+        static const Value& read(const Value& value) { return value; }
+        static Value& write(Value& value) { return value; }
+    };
+
+    struct CopyOnWrite
+    {
+        static usu::cow_ptr<Value> make(std::size_t elements) { return usu::make_cow<Value>(elements, 1); }
+        static const Value& read(const usu::cow_ptr<Value>& value) { return *value; }
+        static Value& write(usu::cow_ptr<Value>& value) { return value.write(); }
+    };
+
+    // Each op hands the previous holder's value on to the next holder and reads
+    // one element of it; every writeEvery ops the new holder also changes it.
+    // writeEvery of 0 never writes.
+    template <typename Policy>
+    void handoff(const std::string& label, std::size_t elements, std::size_t writeEvery)
+    {
+        std::vector<decltype(Policy::make(elements))> holders(HOLDERS, Policy::make(elements));
+        std::size_t current = 0;
+        long long sum = 0;
+        std::size_t op = 0;
+        bench::timeOp(label, OPERATIONS, [&]
+                      {
+                          std::size_t next = (current + 1) % HOLDERS;
+                          holders[next] = holders[current];
+                          current = next;
+                          sum += Policy::read(holders[current])[op % elements];
+                          op++;
+                          if (writeEvery && op % writeEvery == 0)
+                          {
+                              Policy::write(holders[current])[op % elements]++;
+                          }
+                      });
+        bench::doNotOptimize(sum);
+    }
+
+    std::string writeLabel(std::size_t writeEvery)
+    {
+        return writeEvery ? "write 1 in " + std::to_string(writeEvery) : "no writes";
+    }
+} // namespace
+
+BENCHMARK(Cow, Handoff)
+{
+    for (std::size_t elements : { std::size_t{ 16 }, std::size_t{ 1024 }, std::size_t{ 16384 } })
+    {
+        for (std::size_t writeEvery : { std::size_t{ 0 }, std::size_t{ 1000 }, std::size_t{ 100 }, std::size_t{ 10 }, std::size_t{ 2 } })
+        {
+            std::string suffix = ", " + std::to_string(elements) + " ints, " + writeLabel(writeEvery);
+            handoff<DeepCopy>("deep copy" + suffix, elements, writeEvery);
+            handoff<CopyOnWrite>("cow_ptr" + suffix, elements, writeEvery);
+        }
+    }
+}
@@ -0,0 +1,130 @@
+// BenchEpochDomain.cpp
+
+#include "Benchmark.hpp"
+#include "epoch_domain.hpp"
+#include "unique_ptr.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t OPERATIONS = 2'000'000;
+
+    // Treiber stack whose popped nodes are retired to an epoch domain
+    class LockFreeStack
+    {
+      public:
+        ~LockFreeStack()
+        {
+            while (Node* node = head.load())
+            {
+                head = node->next;
+                delete node;
+            }
+        }
+
+        void push(long long value)
+        {
+            auto node = new Node{ value, head.load(std::memory_order_relaxed) };
+            while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        bool pop(long long& value)
+        {
+            usu::epoch_domain::guard guard(domain);
+            Node* top = head.load(std::memory_order_acquire);
+            while (top && !head.compare_exchange_weak(top, top->next, std::memory_order_acquire, std::memory_order_acquire))
+            {
+            }
+            if (!top)
+            {
+                return false;
+            }
+            value = top->value;
+            domain.retire(usu::unique_ptr<Node>(top));
+            return true;
+        }
+
+      private:
+        struct Node
+        {
+            long long value;
+            Node* next;
+        };
+
+        usu::epoch_domain domain;
+        std::atomic<Node*> head{ nullptr };
+    };
+
+    // The same stack with owning nodes behind a mutex
+    class MutexStack
+    {
+      public:
+        void push(long long value)
+        {
+            auto node = usu::make_unique<Node>();
+            node->value = value;
+            std::lock_guard<std::mutex> lock(mutex);
+            node->next = std::move(head);
+            head = std::move(node);
+        }
+
+        bool pop(long long& value)
+        {
+            usu::unique_ptr<Node> top;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!head.get())
+                {
+                    return false;
+                }
+                top = std::move(head);
+                head = std::move(top->next);
+            }
+            value = top->value;
+            return true;
+        }
+
+      private:
+        struct Node
+        {
+            long long value = 0;
+            usu::unique_ptr<Node> next;
+        };
+
+        std::mutex mutex;
+        usu::unique_ptr<Node> head;
+    };
+
+    // Every thread alternates push and pop, the usual work-queue pattern
+    template <typename Stack>
+    void pushPop(const std::string& label)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            Stack stack;
+            std::vector<long long> sums(threads * 8, 0);
+            bench::timeThreads(label + " push + pop", threads, OPERATIONS / threads, [&](unsigned int t)
+                               {
+                                   long long value = 0;
+                                   stack.push(t);
+                                   if (stack.pop(value))
+                                   {
+                                       sums[t * 8] += value;
+                                   }
+                               });
+            bench::doNotOptimize(sums);
+        }
+    }
+} // namespace
+
+BENCHMARK(EpochDomain, Stack)
+{
+    pushPop<LockFreeStack>("lock-free + epoch_domain");
+    pushPop<MutexStack>("mutex");
+}
@@ -0,0 +1,119 @@
+// BenchHazardPointer.cpp
+
+#include "Benchmark.hpp"
+#include "hazard_pointer.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t READS = 4'000'000;
+    constexpr std::size_t ENTRIES = 16;
+
+    struct Entry
+    {
+        explicit Entry(long long v) :
+            value(v)
+        {
+        }
+        long long value;
+    };
+
+    // A small lookup table, read far more often than it changes
+    class HazardTable
+    {
+      public:
+        HazardTable()
+        {
+            for (std::size_t i = 0; i < ENTRIES; i++)
+            {
+                cells[i].store(new Entry(static_cast<long long>(i)));
+            }
+        }
+        ~HazardTable()
+        {
+            for (auto& cell : cells)
+            {
+                delete cell.load();
+            }
+        }
+
+        long long read(usu::hazard_pointer& hazard, std::size_t key) { return hazard.protect(cells[key % ENTRIES])->value; }
+
+        void update(std::size_t key, long long value)
+        {
+            domain.retire(usu::unique_ptr<Entry>(cells[key % ENTRIES].exchange(new Entry(value))));
+        }
+
+        usu::hazard_domain domain;
+
+      private:
+        std::array<std::atomic<Entry*>, ENTRIES> cells;
+    };
+
+    void hazardReads(unsigned int threads, bool withWriter)
+    {
+        HazardTable table;
+        std::atomic<bool> done{ false };
+        std::thread writer;
+        if (withWriter)
+        {
+            writer = std::thread([&]
+                                 {
+                                     for (long long i = 0; !done.load(std::memory_order_relaxed); i++)
+                                     {
+                                         table.update(static_cast<std::size_t>(i), i);
+                                         std::this_thread::yield();
+                                     }
+                                 });
+        }
+        // Slots are claimed by each reader thread on its first read
+        std::vector<usu::unique_ptr<usu::hazard_pointer>> hazards(threads);
+        std::vector<std::size_t> keys(threads * 8, 0);
+        std::vector<long long> sums(threads * 8, 0);
+        bench::timeThreads(withWriter ? "hazard_pointer + writer" : "hazard_pointer", threads, READS / threads, [&](unsigned int t)
+                           {
+                               if (!hazards[t].get())
+                               {
+                                   hazards[t].reset(new usu::hazard_pointer(table.domain));
+                               }
+                               sums[t * 8] += table.read(*hazards[t], keys[t * 8]++);
+                           });
+        done = true;
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+        bench::doNotOptimize(sums);
+    }
+} // namespace
+
+BENCHMARK(HazardPointer, Lookup)
+{
+    for (auto threads : bench::threadCounts())
+    {
+        hazardReads(threads, false);
+        hazardReads(threads, true);
+
+        // Each read copies the owning pointer, paying an increment and a decrement
+        std::vector<usu::shared_ptr<Entry>> shared;
+        for (std::size_t i = 0; i < ENTRIES; i++)
+        {
+            shared.emplace_back(usu::make_shared<Entry>(static_cast<long long>(i)));
+        }
+        std::vector<std::size_t> keys(threads * 8, 0);
+        std::vector<long long> sums(threads * 8, 0);
+        bench::timeThreads("shared_ptr copy per read", threads, READS / threads, [&](unsigned int t)
+                           {
+                               usu::shared_ptr<Entry> copy(shared[keys[t * 8]++ % ENTRIES]);
+                               sums[t * 8] += copy->value;
+                           });
+        bench::doNotOptimize(sums);
+    }
+}
@@ -0,0 +1,65 @@
+// BenchInstrumentation.cpp
+//
+// Also built into SmartPointersBenchInstrumented with USU_INSTRUMENTATION
+// defined; comparing the two runs gives the cost of the hooks
+
+#include "Benchmark.hpp"
+#include "instrumentation.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+    constexpr std::size_t OPERATIONS = 1'000'000;
+
+    struct Widget
+    {
+        int value = 0;
+    };
+
+    std::string mode()
+    {
+        return usu::instrumentation::enabled ? "instrumented " : "plain ";
+    }
+} // namespace
+
+BENCHMARK(Instrumentation, Hooks)
+{
+    // Atomic counts on both sides, as in a real service
+    std::thread([] {}).join();
+
+    auto standard = std::make_shared<Widget>();
+    bench::timeOp("std::shared_ptr copy + destroy", OPERATIONS, [&]
+                  {
+                      auto copy = standard;
+                      bench::doNotOptimize(copy.get());
+                  });
+
+    auto shared = usu::make_shared<Widget>();
+    bench::timeOp(mode() + "shared_ptr copy + destroy", OPERATIONS, [&]
+                  {
+                      auto copy = shared;
+                      bench::doNotOptimize(copy.get());
+                  });
+    bench::timeOp(mode() + "shared_ptr move", OPERATIONS, [&]
+                  {
+                      auto moved = std::move(shared);
+                      bench::doNotOptimize(moved.get());
+                      shared = std::move(moved);
+                  });
+    bench::timeOp(mode() + "make_shared + destroy", OPERATIONS, [&]
+                  {
+                      auto owner = usu::make_shared<Widget>();
+                      bench::doNotOptimize(owner.get());
+                  });
+    bench::timeOp(mode() + "make_unique + destroy", OPERATIONS, [&]
+                  {
+                      auto owner = usu::make_unique<Widget>();
+                      bench::doNotOptimize(owner.get());
+                  });
+}
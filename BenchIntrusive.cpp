@@ -0,0 +1,92 @@
+// BenchIntrusive.cpp
+
+#include "Benchmark.hpp"
+#include "intrusive_ptr.hpp"
+#include "shared_ptr.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace
+{
+    constexpr std::size_t NODES = 1'000'000;
+
+    struct SharedNode
+    {
+        usu::shared_ptr<SharedNode> next;
+        long long value = 0;
+    };
+
+    template <typename Counter>
+    struct IntrusiveNode : usu::intrusive_ref_counter<IntrusiveNode<Counter>, Counter>
+    {
+        usu::intrusive_ptr<IntrusiveNode> next;
+        long long value = 0;
+    };
+
+    // Builds a singly linked list of NODES nodes and returns its head
+    template <typename Ptr, typename Factory>
+    Ptr buildList(Factory&& factory)
+    {
+        Ptr head;
+        for (std::size_t i = 0; i < NODES; i++)
+        {
+            Ptr node = factory();
+            node->value = static_cast<long long>(i);
+            node->next = head;
+            head = node;
+        }
+        return head;
+    }
+
+    // Unlinks one node at a time, so destroying a long list cannot overflow the stack
+    template <typename Ptr>
+    void destroyList(Ptr& head)
+    {
+        while (head.get())
+        {
+            Ptr next = head->next;
+            head = next;
+        }
+    }
+
+    template <typename Ptr, typename Factory>
+    void walk(const std::string& label, Factory&& factory)
+    {
+        bench::report(label + " handle size", static_cast<double>(sizeof(Ptr)), "bytes");
+        Ptr head = buildList<Ptr>(factory);
+
+        // Traversal through the handles without taking any references
+        long long sum = 0;
+        bench::timeOp(label + " traverse", 1, [&]
+                      {
+                          for (auto node = head.get(); node; node = node->next.get())
+                          {
+                              sum += node->value;
+                          }
+                      });
+
+        // A cursor that owns the node it is on, copying the handle at every hop
+        bench::timeOp(label + " copying cursor", 1, [&]
+                      {
+                          Ptr cursor = head;
+                          while (cursor.get())
+                          {
+                              sum += cursor->value;
+                              cursor = cursor->next;
+                          }
+                      });
+        bench::doNotOptimize(sum);
+        destroyList(head);
+    }
+} // namespace
+
+BENCHMARK(Intrusive, LinkedList)
+{
+    walk<usu::shared_ptr<SharedNode>>("shared_ptr", []
+                                      { return usu::make_shared<SharedNode>(); });
+    walk<usu::intrusive_ptr<IntrusiveNode<usu::thread_safe_counter>>>("intrusive_ptr (atomic)", []
+                                                                      { return usu::make_intrusive<IntrusiveNode<usu::thread_safe_counter>>(); });
+    walk<usu::intrusive_ptr<IntrusiveNode<usu::thread_unsafe_counter>>>("intrusive_ptr (non-atomic)", []
+                                                                        { return usu::make_intrusive<IntrusiveNode<usu::thread_unsafe_counter>>(); });
+}
@@ -0,0 +1,251 @@
+// BenchMain.cpp
+
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #include <unistd.h>
+#endif
+
+// Count every global allocation so benchmarks can report allocations per object
+static std::atomic<std::size_t> g_allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Over-aligned requests, which is how the slab pool gets its slabs
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+    void* ptr = _aligned_malloc(size ? size : 1, align);
+#else
+    void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+    if (ptr)
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+
+namespace bench
+{
+    std::vector<Case>& registry()
+    {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    std::size_t allocationCount()
+    {
+        return g_allocations.load(std::memory_order_relaxed);
+    }
+
+    std::size_t residentBytes()
+    {
+#if defined(__linux__)
+        std::ifstream statm("/proc/self/statm");
+        std::size_t pages = 0;
+        std::size_t resident = 0;
+        if (statm >> pages >> resident)
+        {
+            return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        }
+#endif
+        return 0;
+    }
+
+    namespace
+    {
+        struct Result
+        {
+            std::string benchCase;
+            std::string metric;
+            double value;
+            std::string unit;
+        };
+
+        std::string currentCase;
+        std::vector<Result> results;
+
+        std::string jsonString(const std::string& text)
+        {
+            std::ostringstream out;
+            out << '"';
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    out << '\\' << c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                }
+                else
+                {
+                    out << c;
+                }
+            }
+            out << '"';
+            return out.str();
+        }
+
+        // Every measurement of the run, for comparing numbers release to release
+        bool writeJson(const std::string& path)
+        {
+            std::ofstream out(path);
+            out << "{\n  \"context\": {\n"
+#if defined(__VERSION__)
+                << "    \"compiler\": " << jsonString(__VERSION__) << ",\n"
+#endif
+                << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << "\n  },\n"
+                << "  \"results\": [";
+            for (std::size_t i = 0; i < results.size(); i++)
+            {
+                const auto& result = results[i];
+                out << (i ? ",\n" : "\n") << "    { \"case\": " << jsonString(result.benchCase)
+                    << ", \"metric\": " << jsonString(result.metric)
+                    << ", \"value\": ";
+                // JSON has no NaN or infinity
+                if (std::isfinite(result.value))
+                {
+                    out << std::setprecision(17) << result.value;
+                }
+                else
+                {
+                    out << "null";
+                }
+                out << ", \"unit\": " << jsonString(result.unit) << " }";
+            }
+            out << "\n  ]\n}\n";
+            return static_cast<bool>(out);
+        }
+    } // namespace
+
+    void report(const std::string& metric, double value, const std::string& unit)
+    {
+        results.push_back({ currentCase, metric, value, unit });
+        std::cout << "    " << std::left << std::setw(48) << metric
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(2) << value
+                  << " " << unit << std::endl;
+    }
+
+    void reportPercentiles(const std::string& metric, std::vector<double> samples)
+    {
+        if (samples.empty())
+        {
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p)
+        { return samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))]; };
+        report(metric + " p50", percentile(0.50), "ns");
+        report(metric + " p99", percentile(0.99), "ns");
+        report(metric + " p99.9", percentile(0.999), "ns");
+        report(metric + " max", samples.back(), "ns");
+    }
+
+    std::vector<unsigned int> threadCounts()
+    {
+        unsigned int cores = std::max(std::thread::hardware_concurrency(), 4u);
+        std::vector<unsigned int> counts;
+        for (unsigned int threads = 1; threads <= cores; threads *= 2)
+        {
+            counts.push_back(threads);
+        }
+        return counts;
+    }
+} // namespace bench
+
+// ------------------------------------------------------------------
+//
+// Runs every registered benchmark, or only the groups named on the
+// command line. --json <path> also writes every measurement to path.
+//
+// ------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> groups;
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--json")
+        {
+            if (i + 1 == argc)
+            {
+                std::cerr << "usage: " << argv[0] << " [group...] [--json path]" << std::endl;
+                return 2;
+            }
+            jsonPath = argv[++i];
+        }
+        else
+        {
+            groups.push_back(argument);
+        }
+    }
+
+    for (auto& benchCase : bench::registry())
+    {
+        bool selected = groups.empty() || std::find(groups.begin(), groups.end(), benchCase.group) != groups.end();
+        if (selected)
+        {
+            bench::currentCase = benchCase.group + "." + benchCase.name;
+            std::cout << bench::currentCase << std::endl;
+            benchCase.body();
+        }
+    }
+
+    if (!jsonPath.empty() && !bench::writeJson(jsonPath))
+    {
+        std::cerr << "Unable to write " << jsonPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
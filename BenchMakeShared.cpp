@@ -0,0 +1,98 @@
+// BenchMakeShared.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Node
+    {
+        Node() = default;
+        explicit Node(int v) :
+            value(v)
+        {
+        }
+        int value = 0;
+        int padding[7] = {};
+    };
+
+    constexpr std::size_t OBJECTS = 1'000'000;
+
+    // The layout make_shared used to produce: the object and the count in separate
+    // allocations. The count now comes from the slab pool, so only the object hits new.
+    usu::shared_ptr<Node> makeTwoAllocations(int value)
+    {
+        return usu::shared_ptr<Node>(new Node(value));
+    }
+
+    usu::shared_ptr<Node> makeSingleAllocation(int value)
+    {
+        return usu::make_shared<Node>(value);
+    }
+
+    template <typename Factory>
+    void runLayout(const std::string& label, Factory&& factory)
+    {
+        std::vector<usu::shared_ptr<Node>> nodes;
+        nodes.reserve(OBJECTS);
+
+        auto before = bench::allocationCount();
+        std::size_t next = 0;
+        bench::timeOp(label + " construct", OBJECTS, [&]
+                      { nodes.emplace_back(factory(static_cast<int>(next++))); });
+        double perObject = static_cast<double>(bench::allocationCount() - before) / OBJECTS;
+        bench::report(label + " allocations", perObject, "allocs/object");
+
+        // Visit in random order so each access misses the cache, as in a real object graph
+        std::vector<std::size_t> order(OBJECTS);
+        for (std::size_t i = 0; i < OBJECTS; i++)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+        std::size_t index = 0;
+        long long sum = 0;
+        bench::timeOp(label + " deref", OBJECTS, [&]
+                      { sum += nodes[order[index++]]->value; });
+        bench::doNotOptimize(sum);
+
+        index = 0;
+        bench::timeOp(label + " copy + deref", OBJECTS, [&]
+                      {
+                          usu::shared_ptr<Node> copy(nodes[order[index++]]);
+                          sum += copy->value;
+                      });
+        bench::doNotOptimize(sum);
+
+        bench::timeOp(label + " destroy", 1, [&]
+                      { nodes.clear(); });
+    }
+} // namespace
+
+BENCHMARK(MakeShared, TwoAllocationLayout)
+{
+    runLayout("two allocations", makeTwoAllocations);
+}
+
+BENCHMARK(MakeShared, SingleAllocationLayout)
+{
+    runLayout("make_shared", makeSingleAllocation);
+}
+
+BENCHMARK(MakeShared, Array)
+{
+    auto before = bench::allocationCount();
+    bench::timeOp("make_shared_array<int, 16>", OBJECTS, []
+                  {
+                      auto array = usu::make_shared_array<int, 16>();
+                      bench::doNotOptimize(array[0]);
+                  });
+    double perObject = static_cast<double>(bench::allocationCount() - before) / OBJECTS;
+    bench::report("make_shared_array allocations", perObject, "allocs/object");
+}
@@ -0,0 +1,90 @@
+// BenchMappedArray.cpp
+
+#include "Benchmark.hpp"
+#include "mapped_array.hpp"
+
+#if __has_include(<sys/mman.h>)
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t TABLE_BYTES = 512 * 1024 * 1024;
+    constexpr std::size_t ELEMENTS = TABLE_BYTES / sizeof(std::uint64_t);
+    constexpr std::size_t LOOKUPS = 1'000'000;
+
+    std::string writeTable()
+    {
+        auto path = (std::filesystem::temp_directory_path() / "usu_bench_table.bin").string();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::vector<std::uint64_t> block(1 << 16);
+        for (std::size_t written = 0; written < ELEMENTS; written += block.size())
+        {
+            for (std::size_t i = 0; i < block.size(); i++)
+            {
+                block[i] = written + i;
+            }
+            out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(std::uint64_t)));
+        }
+        return path;
+    }
+
+    // The path tables are loaded with today: allocate, then read() the whole file
+    usu::shared_ptr<std::uint64_t[]> loadTable(const std::string& path)
+    {
+        usu::shared_ptr<std::uint64_t[]> table(new std::uint64_t[ELEMENTS], ELEMENTS);
+        {
+            usu::detail::file_descriptor file(::open(path.c_str(), O_RDONLY));
+            auto bytes = reinterpret_cast<char*>(table.get());
+            std::size_t done = 0;
+            while (done < TABLE_BYTES)
+            {
+                auto got = ::read(file.fd, bytes + done, TABLE_BYTES - done);
+                if (got <= 0)
+                {
+                    break;
+                }
+                done += static_cast<std::size_t>(got);
+            }
+        }
+        return table;
+    }
+
+    template <typename Table, typename Load>
+    void startup(const std::string& label, Load&& load)
+    {
+        auto before = bench::residentBytes();
+        Table table;
+        bench::timeOp(label + " startup", 1, [&]
+                      { table = load(); });
+
+        // Random lookups afterwards, where a mapping pays for its page faults
+        std::uint64_t state = 88172645463325252ull;
+        std::uint64_t sum = 0;
+        bench::timeOp(label + " first lookups", LOOKUPS, [&]
+                      {
+                          state = state * 6364136223846793005ull + 1442695040888963407ull;
+                          sum += table[(state >> 16) % ELEMENTS];
+                      });
+        bench::doNotOptimize(sum);
+        bench::report(label + " resident growth", static_cast<double>(bench::residentBytes() - before) / (1024 * 1024), "MiB");
+    }
+} // namespace
+
+// The file is freshly written, so every variant starts from a warm page cache
+BENCHMARK(MappedArray, Startup512MB)
+{
+    auto path = writeTable();
+    startup<usu::shared_ptr<std::uint64_t[]>>("new T[] + read()", [&]
+                                               { return loadTable(path); });
+    startup<usu::shared_ptr<const std::uint64_t[]>>("map_shared_array", [&]
+                                                     { return usu::map_shared_array<const std::uint64_t>(path); });
+    startup<usu::shared_ptr<const std::uint64_t[]>>("map_shared_array (populate)", [&]
+                                                     { return usu::map_shared_array<const std::uint64_t>(path, usu::map_mode::read_only, { usu::map_advice::random, false, true }); });
+    std::filesystem::remove(path);
+}
+#endif
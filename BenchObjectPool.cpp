@@ -0,0 +1,71 @@
+// BenchObjectPool.cpp
+
+#include "Benchmark.hpp"
+#include "object_pool.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t CYCLES = 200'000;
+
+    // Stands in for a parser: construction allocates and zeroes a 64 KiB buffer
+    struct Parser
+    {
+        std::vector<char> buffer = std::vector<char>(64 * 1024);
+        std::size_t used = 0;
+
+        void parse(std::size_t bytes)
+        {
+            buffer[used % buffer.size()] = 1;
+            used += bytes;
+        }
+    };
+
+    void resetParser(Parser& parser)
+    {
+        parser.used = 0;
+    }
+} // namespace
+
+BENCHMARK(ObjectPool, AcquireRelease)
+{
+    bench::timeOp("make_unique + destroy", CYCLES, []
+                  {
+                      auto parser = usu::make_unique<Parser>();
+                      parser->parse(100);
+                      bench::doNotOptimize(parser->used);
+                  });
+
+    usu::object_pool<Parser> pool(resetParser);
+    bench::timeOp("object_pool acquire + release", CYCLES, [&]
+                  {
+                      auto parser = pool.acquire();
+                      parser->parse(100);
+                      bench::doNotOptimize(parser->used);
+                  });
+    bench::report("object_pool objects built", static_cast<double>(pool.constructed()), "objects");
+}
+
+BENCHMARK(ObjectPool, Threads)
+{
+    for (auto threads : bench::threadCounts())
+    {
+        bench::timeThreads("make_unique + destroy", threads, CYCLES / threads, [](unsigned int)
+                           {
+                               auto parser = usu::make_unique<Parser>();
+                               parser->parse(100);
+                               bench::doNotOptimize(parser->used);
+                           });
+        usu::object_pool<Parser> pool(resetParser);
+        bench::timeThreads("object_pool acquire + release", threads, CYCLES / threads, [&](unsigned int)
+                           {
+                               auto parser = pool.acquire();
+                               parser->parse(100);
+                               bench::doNotOptimize(parser->used);
+                           });
+    }
+}
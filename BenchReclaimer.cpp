@@ -0,0 +1,69 @@
+// BenchReclaimer.cpp
+
+#include "Benchmark.hpp"
+#include "reclaimer.hpp"
+#include "shared_ptr.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A large structure whose destruction is a cascade of frees
+    struct Graph
+    {
+        explicit Graph(std::size_t leaves)
+        {
+            nodes.reserve(leaves);
+            for (std::size_t i = 0; i < leaves; i++)
+            {
+                nodes.emplace_back(usu::make_shared<std::string>(48, static_cast<char>('a' + i % 26)));
+            }
+        }
+        std::vector<usu::shared_ptr<std::string>> nodes;
+    };
+
+    constexpr std::size_t REQUESTS = 2000;
+
+    // Each request drops the last owner of a fresh graph; only the drop is timed
+    template <typename Factory>
+    void dropLatency(const std::string& label, std::size_t leaves, Factory&& factory)
+    {
+        std::vector<double> samples;
+        samples.reserve(REQUESTS);
+        for (std::size_t i = 0; i < REQUESTS; i++)
+        {
+            usu::shared_ptr<Graph> graph = factory(leaves);
+            auto start = std::chrono::steady_clock::now();
+            graph = usu::shared_ptr<Graph>();
+            samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        bench::reportPercentiles(label + " (" + std::to_string(leaves) + " leaves)", std::move(samples));
+    }
+} // namespace
+
+BENCHMARK(Reclaimer, DropLastOwner)
+{
+    for (std::size_t leaves : { 1000, 10000 })
+    {
+        dropLatency("inline", leaves, [](std::size_t n)
+                    { return usu::make_shared<Graph>(n); });
+
+        usu::reclaimer background;
+        background.start();
+        dropLatency("deferred, background thread", leaves, [&](std::size_t n)
+                    { return usu::make_shared_deferred<Graph>(background, n); });
+        background.stop();
+        background.drain();
+
+        // The request thread drains between requests, off the measured path
+        usu::reclaimer explicitDrain;
+        dropLatency("deferred, drain()", leaves, [&](std::size_t n)
+                    {
+                        explicitDrain.drain();
+                        return usu::make_shared_deferred<Graph>(explicitDrain, n);
+                    });
+    }
+}
@@ -0,0 +1,55 @@
+// BenchRefCount.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+
+#include <memory>
+
+namespace
+{
+    constexpr std::size_t COPIES = 2'000'000;
+    constexpr std::size_t THREAD_COPIES = 500'000;
+
+    // Copy-then-destroy of a pointer owned by the calling thread
+    template <typename Pointer>
+    void copyLocal(const std::string& label, Pointer& source)
+    {
+        bench::timeOp(label + " copy/destroy", COPIES, [&]
+                      {
+                          Pointer copy(source);
+                          bench::doNotOptimize(copy);
+                      });
+    }
+
+    // Every thread copies and destroys the same pointer, so they all hit one count
+    template <typename Pointer>
+    void copyShared(const std::string& label, Pointer& source)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            bench::timeThreads(label + " shared copy/destroy", threads, THREAD_COPIES, [&](unsigned int)
+                               {
+                                   Pointer copy(source);
+                                   bench::doNotOptimize(copy);
+                               });
+        }
+    }
+} // namespace
+
+BENCHMARK(RefCount, SingleThread)
+{
+    auto local = usu::make_shared<int, usu::thread_unsafe_counter>(1);
+    auto atomic = usu::make_shared<int>(1);
+    auto standard = std::make_shared<int>(1);
+    copyLocal("usu::local_shared_ptr", local);
+    copyLocal("usu::shared_ptr", atomic);
+    copyLocal("std::shared_ptr", standard);
+}
+
+BENCHMARK(RefCount, MultiThread)
+{
+    auto atomic = usu::make_shared<int>(1);
+    auto standard = std::make_shared<int>(1);
+    copyShared("usu::shared_ptr", atomic);
+    copyShared("std::shared_ptr", standard);
+}
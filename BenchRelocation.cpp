@@ -0,0 +1,76 @@
+// BenchRelocation.cpp
+
+#include "Benchmark.hpp"
+#include "relocating_vector.hpp"
+#include "shared_ptr.hpp"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t PUSHES = 10'000'000;
+
+    // Copyable but without a noexcept move, so std::vector copies it on growth:
+    // two count updates per element per reallocation
+    struct CopiedOnGrowth
+    {
+        explicit CopiedOnGrowth(const usu::shared_ptr<int>& ptr) :
+            ptr(ptr)
+        {
+        }
+        CopiedOnGrowth(const CopiedOnGrowth&) = default;
+        CopiedOnGrowth(CopiedOnGrowth&& other) noexcept(false) :
+            ptr(std::move(other.ptr))
+        {
+        }
+
+        usu::shared_ptr<int> ptr;
+    };
+
+    template <typename Vector>
+    void pushAll(const std::string& label, const usu::shared_ptr<int>& shared)
+    {
+        bench::timeOp(label, 1, [&]
+                      {
+                          Vector pointers;
+                          for (std::size_t i = 0; i < PUSHES; i++)
+                          {
+                              pointers.emplace_back(shared);
+                          }
+                          bench::doNotOptimize(pointers.data());
+                      });
+    }
+} // namespace
+
+// Pushes 10M copies of one pointer into a vector that starts empty, so it
+// reallocates about 24 times along the way
+BENCHMARK(Relocation, Push10M)
+{
+    auto shared = usu::make_shared<int>(1);
+    pushAll<std::vector<CopiedOnGrowth>>("std::vector, copy on growth", shared);
+    pushAll<std::vector<usu::shared_ptr<int>>>("std::vector, noexcept move", shared);
+    pushAll<usu::relocating_vector<usu::shared_ptr<int>>>("relocating_vector, memcpy", shared);
+}
+
+// One reallocation of a full 10M-element vector, which is what each growth
+// step above costs without the pushes around it
+BENCHMARK(Relocation, Grow10M)
+{
+    auto shared = usu::make_shared<int>(1);
+    auto grow = [&]<typename Vector>(const std::string& label, Vector pointers)
+    {
+        pointers.reserve(PUSHES);
+        for (std::size_t i = 0; i < PUSHES; i++)
+        {
+            pointers.emplace_back(shared);
+        }
+        bench::timeOp(label, 1, [&]
+                      { pointers.reserve(PUSHES * 2); });
+    };
+    grow("std::vector, copy on growth", std::vector<CopiedOnGrowth>());
+    grow("std::vector, noexcept move", std::vector<usu::shared_ptr<int>>());
+    grow("relocating_vector, memcpy", usu::relocating_vector<usu::shared_ptr<int>>());
+}
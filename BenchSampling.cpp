@@ -0,0 +1,61 @@
+// BenchSampling.cpp
+
+#include "Benchmark.hpp"
+#include "sampling.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t OPERATIONS = 2'000'000;
+    // Objects kept alive while measuring, so destruction sees live samples
+    constexpr std::size_t LIVE = 16 * 1024;
+
+    struct Payload
+    {
+        std::array<char, 64> bytes{};
+    };
+
+    // Replaces one object of a ring of live ones per iteration: one make and
+    // one destruction per op
+    template <typename Pointer, typename Make>
+    void churn(const std::string& label, Make&& make)
+    {
+        std::vector<Pointer> ring;
+        ring.reserve(LIVE);
+        for (std::size_t i = 0; i < LIVE; i++)
+        {
+            ring.push_back(make());
+        }
+        std::size_t next = 0;
+        bench::timeOp(label, OPERATIONS, [&]
+                      {
+                          ring[next] = make();
+                          next = (next + 1) % LIVE;
+                      });
+        bench::report(label + " live samples", static_cast<double>(usu::sampling::live_samples().size()), "samples");
+    }
+
+    std::string rateLabel(std::size_t interval)
+    {
+        return interval ? "1 in " + std::to_string(interval) : "off";
+    }
+} // namespace
+
+BENCHMARK(Sampling, Overhead)
+{
+    for (std::size_t interval : { std::size_t{ 0 }, std::size_t{ 1 } << 20, std::size_t{ 1 } << 16, std::size_t{ 4096 }, std::size_t{ 512 }, std::size_t{ 64 } })
+    {
+        usu::sampling::set_interval(interval);
+        churn<usu::shared_ptr<Payload>>("make_shared, sampling " + rateLabel(interval), []
+                                        { return usu::make_shared<Payload>(); });
+        churn<usu::unique_ptr<Payload>>("make_unique, sampling " + rateLabel(interval), []
+                                        { return usu::make_unique<Payload>(); });
+    }
+    usu::sampling::set_interval(0);
+}
@@ -0,0 +1,46 @@
+// BenchShardedShared.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+#include "sharded_shared_ptr.hpp"
+
+#include <vector>
+
+namespace
+{
+    struct Payload
+    {
+        int value = 1;
+    };
+
+    constexpr std::size_t COPIES = 500'000;
+
+    // Each thread keeps its own handle, as worker threads holding a shared
+    // object do, then copies and drops that handle in its hot loop
+    template <typename Pointer>
+    void copyScaling(const std::string& label, Pointer& source)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            std::vector<Pointer> anchors(threads);
+            bench::timeThreads(label + " copy/destroy", threads, COPIES, [&](unsigned int t)
+                               {
+                                   if (!anchors[t].get())
+                                   {
+                                       anchors[t] = source;
+                                   }
+                                   Pointer copy(anchors[t]);
+                                   bench::doNotOptimize(copy);
+                               });
+        }
+    }
+} // namespace
+
+BENCHMARK(ShardedShared, CopyScaling)
+{
+    auto atomic = usu::make_shared<Payload>();
+    copyScaling("usu::shared_ptr", atomic);
+
+    auto sharded = usu::make_sharded_shared<Payload>();
+    copyScaling("usu::sharded_shared_ptr", sharded);
+}
@@ -0,0 +1,64 @@
+// BenchSharedDeleter.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+    constexpr std::size_t OBJECTS = 2'000'000;
+
+    // Builds and drops one owner per iteration and reports the time and the
+    // global allocations it took, the object's own included
+    template <typename Make>
+    void constructDestroy(const std::string& label, Make&& make)
+    {
+        auto before = bench::allocationCount();
+        bench::timeOp(label, OBJECTS, [&]
+                      {
+                          auto owner = make();
+                          bench::doNotOptimize(owner.get());
+                      });
+        bench::report(label + " allocations", static_cast<double>(bench::allocationCount() - before) / OBJECTS, "allocs/op");
+    }
+} // namespace
+
+BENCHMARK(SharedDeleter, ConstructDestroy)
+{
+    // libstdc++ drops to plain increments until a thread has been started; both
+    // pointers are compared with atomic counts, as in a real service
+    std::thread([] {}).join();
+
+    bench::report("sizeof usu::shared_ptr<int>", sizeof(usu::shared_ptr<int>), "bytes");
+    bench::report("sizeof std::shared_ptr<int>", sizeof(std::shared_ptr<int>), "bytes");
+
+    auto stateless = [](int* ptr)
+    { delete ptr; };
+    constructDestroy("std::shared_ptr, stateless lambda", [&]
+                     { return std::shared_ptr<int>(new int(1), stateless); });
+    constructDestroy("usu::shared_ptr, stateless lambda", [&]
+                     { return usu::shared_ptr<int>(new int(1), stateless); });
+
+    // A deleter with state: a counter it bumps on every call
+    std::size_t released = 0;
+    auto stateful = [&released](int* ptr)
+    {
+        released++;
+        delete ptr;
+    };
+    constructDestroy("std::shared_ptr, capturing lambda", [&]
+                     { return std::shared_ptr<int>(new int(1), stateful); });
+    constructDestroy("usu::shared_ptr, capturing lambda", [&]
+                     { return usu::shared_ptr<int>(new int(1), stateful); });
+
+    // The same allocator for both, so the difference is the block itself
+    constructDestroy("std::shared_ptr, lambda + std::allocator", [&]
+                     { return std::shared_ptr<int>(new int(1), stateful, std::allocator<int>()); });
+    constructDestroy("usu::shared_ptr, lambda + std::allocator", [&]
+                     { return usu::shared_ptr<int>(new int(1), stateful, std::allocator<int>()); });
+    bench::doNotOptimize(released);
+}
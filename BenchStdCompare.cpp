@@ -0,0 +1,217 @@
+// BenchStdCompare.cpp
+
+#include "Benchmark.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t OPERATIONS = 1'000'000;
+    constexpr std::size_t THREAD_OPERATIONS = 250'000;
+    constexpr std::size_t POINTERS = 4096;
+    constexpr std::size_t ELEMENTS = 1 << 16;
+    constexpr std::size_t ROUNDS = 200;
+
+    // libstdc++ drops to plain increments until a thread has been started; the
+    // comparisons use atomic counts on both sides, as in a real service
+    void useAtomicCounts()
+    {
+        std::thread([] {}).join();
+    }
+
+    // Construction, destruction, copies, moves and dereference of one kind of
+    // single-object pointer; copies are skipped for move-only pointers
+    template <typename Pointer, typename Make>
+    void singleObject(const std::string& label, Make&& make)
+    {
+        bench::timeOp(label + " make + destroy", OPERATIONS, [&]
+                      {
+                          Pointer owner = make(1);
+                          bench::doNotOptimize(owner.get());
+                      });
+
+        std::vector<Pointer> owners;
+        owners.reserve(OPERATIONS);
+        bench::timeOp(label + " make", OPERATIONS, [&]
+                      { owners.push_back(make(1)); });
+        bench::timeOp(label + " destroy", OPERATIONS, [&]
+                      { owners.pop_back(); });
+
+        Pointer first = make(1);
+        Pointer second = make(2);
+        if constexpr (std::is_copy_constructible_v<Pointer>)
+        {
+            bench::timeOp(label + " copy + destroy", OPERATIONS, [&]
+                          {
+                              Pointer copy(first);
+                              bench::doNotOptimize(copy.get());
+                          });
+            Pointer target = first;
+            std::size_t turn = 0;
+            bench::timeOp(label + " copy assign", OPERATIONS, [&]
+                          {
+                              target = (turn++ & 1) ? first : second;
+                              bench::doNotOptimize(target.get());
+                          });
+        }
+        bench::timeOp(label + " move construct + move assign", OPERATIONS, [&]
+                      {
+                          Pointer moved(std::move(first));
+                          first = std::move(moved);
+                          bench::doNotOptimize(first.get());
+                      });
+
+        // One dereference per pointer, spread over distinct objects
+        for (std::size_t i = 0; i < POINTERS; i++)
+        {
+            owners.push_back(make(static_cast<int>(i)));
+        }
+        long long total = 0;
+        double ns = bench::timeOp(label + " deref " + std::to_string(POINTERS), ROUNDS, [&]
+                                  {
+                                      for (auto& owner : owners)
+                                      {
+                                          total += *owner;
+                                      }
+                                  });
+        bench::doNotOptimize(total);
+        bench::report(label + " deref per pointer", ns / POINTERS, "ns");
+    }
+
+    // Allocation, copy (where the pointer allows it) and a sequential indexing
+    // loop over one kind of array pointer
+    template <typename Pointer, typename Make, typename Index>
+    void array(const std::string& label, Make&& make, Index&& index)
+    {
+        bench::timeOp(label + " make + destroy " + std::to_string(ELEMENTS), ROUNDS, [&]
+                      {
+                          Pointer owner = make(ELEMENTS);
+                          bench::doNotOptimize(owner.get());
+                      });
+
+        Pointer values = make(ELEMENTS);
+        if constexpr (std::is_copy_constructible_v<Pointer>)
+        {
+            bench::timeOp(label + " copy + destroy", OPERATIONS, [&]
+                          {
+                              Pointer copy(values);
+                              bench::doNotOptimize(copy.get());
+                          });
+        }
+        long long total = 0;
+        double ns = bench::timeOp(label + " index loop", ROUNDS, [&]
+                                  {
+                                      for (std::size_t i = 0; i < ELEMENTS; i++)
+                                      {
+                                          total += index(values, i);
+                                      }
+                                  });
+        bench::doNotOptimize(total);
+        bench::report(label + " index per element", ns / ELEMENTS, "ns");
+    }
+
+    // Every thread builds and drops its own objects, so only the allocator is shared
+    template <typename Make>
+    void makeScaling(const std::string& label, Make&& make)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            bench::timeThreads(label + " make + destroy", threads, THREAD_OPERATIONS, [&](unsigned int)
+                               {
+                                   auto owner = make(1);
+                                   bench::doNotOptimize(owner.get());
+                               });
+        }
+    }
+
+    // Every thread copies and drops the same pointer, so they all hit one count
+    template <typename Pointer>
+    void copyScaling(const std::string& label, const Pointer& source)
+    {
+        for (auto threads : bench::threadCounts())
+        {
+            bench::timeThreads(label + " shared copy + destroy", threads, THREAD_OPERATIONS, [&](unsigned int)
+                               {
+                                   Pointer copy(source);
+                                   bench::doNotOptimize(copy.get());
+                               });
+        }
+    }
+} // namespace
+
+BENCHMARK(Compare, SharedPtr)
+{
+    useAtomicCounts();
+    singleObject<std::shared_ptr<int>>("std::shared_ptr", [](int value)
+                                       { return std::make_shared<int>(value); });
+    singleObject<usu::shared_ptr<int>>("usu::shared_ptr", [](int value)
+                                       { return usu::make_shared<int>(value); });
+}
+
+BENCHMARK(Compare, UniquePtr)
+{
+    singleObject<std::unique_ptr<int>>("std::unique_ptr", [](int value)
+                                       { return std::make_unique<int>(value); });
+    singleObject<usu::unique_ptr<int>>("usu::unique_ptr", [](int value)
+                                       { return usu::make_unique<int>(value); });
+}
+
+BENCHMARK(Compare, SharedArray)
+{
+    useAtomicCounts();
+    array<std::shared_ptr<int[]>>(
+        "std::shared_ptr<T[]>", [](std::size_t size)
+        { return std::make_shared<int[]>(size); },
+        [](const std::shared_ptr<int[]>& values, std::size_t i)
+        { return values[i]; });
+    array<usu::shared_ptr<int[]>>(
+        "usu::shared_ptr<T[]>", [](std::size_t size)
+        { return usu::make_shared_array<int>(size); },
+        [](const usu::shared_ptr<int[]>& values, std::size_t i)
+        { return values[i]; });
+    array<usu::shared_ptr<int[]>>(
+        "usu::shared_ptr<T[]> unchecked", [](std::size_t size)
+        { return usu::make_shared_array<int>(size); },
+        [](const usu::shared_ptr<int[]>& values, std::size_t i)
+        { return values.element<usu::unchecked_access>(i); });
+}
+
+BENCHMARK(Compare, UniqueArray)
+{
+    array<std::unique_ptr<int[]>>(
+        "std::unique_ptr<T[]>", [](std::size_t size)
+        { return std::make_unique<int[]>(size); },
+        [](const std::unique_ptr<int[]>& values, std::size_t i)
+        { return values[i]; });
+    array<usu::unique_ptr<int[]>>(
+        "usu::unique_ptr<T[]>", [](std::size_t size)
+        { return usu::make_unique<int[]>(size); },
+        [](const usu::unique_ptr<int[]>& values, std::size_t i)
+        { return values[i]; });
+}
+
+BENCHMARK(Compare, MultiThread)
+{
+    useAtomicCounts();
+    makeScaling("std::make_shared", [](int value)
+                { return std::make_shared<int>(value); });
+    makeScaling("usu::make_shared", [](int value)
+                { return usu::make_shared<int>(value); });
+    makeScaling("std::make_unique", [](int value)
+                { return std::make_unique<int>(value); });
+    makeScaling("usu::make_unique", [](int value)
+                { return usu::make_unique<int>(value); });
+
+    auto standard = std::make_shared<int>(1);
+    auto atomic = usu::make_shared<int>(1);
+    copyScaling("std::shared_ptr", standard);
+    copyScaling("usu::shared_ptr", atomic);
+}
@@ -0,0 +1,71 @@
+// BenchUniqueDeleter.cpp
+
+#include "Benchmark.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+    constexpr std::size_t OBJECTS = 2'000'000;
+
+    struct free_delete
+    {
+        void operator()(int* ptr) const { std::free(ptr); }
+    };
+
+    int* allocateInt()
+    {
+        auto ptr = static_cast<int*>(std::malloc(sizeof(int)));
+        *ptr = 1;
+        return ptr;
+    }
+
+    // The stored function pointer is hidden from the optimizer, as it is for a
+    // deleter chosen at run time, so the call cannot be inlined
+    void (*opaqueFree())(void*)
+    {
+        void (*fn)(void*) = std::free;
+        bench::doNotOptimize(fn);
+        return fn;
+    }
+} // namespace
+
+// A stateless deleter should cost exactly what the hand-written call does: it
+// takes no space in the pointer and its call inlines
+BENCHMARK(UniqueDeleter, CallCost)
+{
+    bench::report("sizeof unique_ptr<int>", sizeof(usu::unique_ptr<int>), "bytes");
+    bench::report("sizeof unique_ptr<int, free_delete>", sizeof(usu::unique_ptr<int, free_delete>), "bytes");
+    bench::report("sizeof unique_ptr<int, void (*)(void*)>", sizeof(usu::unique_ptr<int, void (*)(void*)>), "bytes");
+
+    bench::timeOp("malloc + free by hand", OBJECTS, []
+                  {
+                      int* ptr = allocateInt();
+                      bench::doNotOptimize(*ptr);
+                      std::free(ptr);
+                  });
+    bench::timeOp("unique_ptr<int, free_delete>", OBJECTS, []
+                  {
+                      usu::unique_ptr<int, free_delete> ptr(allocateInt());
+                      bench::doNotOptimize(*ptr);
+                  });
+    bench::timeOp("unique_ptr<int, void (*)(void*)>", OBJECTS, []
+                  {
+                      usu::unique_ptr<int, void (*)(void*)> ptr(allocateInt(), opaqueFree());
+                      bench::doNotOptimize(*ptr);
+                  });
+    bench::timeOp("new + delete by hand", OBJECTS, []
+                  {
+                      int* ptr = new int(1);
+                      bench::doNotOptimize(*ptr);
+                      delete ptr;
+                  });
+    bench::timeOp("unique_ptr<int> (default_delete)", OBJECTS, []
+                  {
+                      usu::unique_ptr<int> ptr(new int(1));
+                      bench::doNotOptimize(*ptr);
+                  });
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ------------------------------------------------------------------
+//
+// Minimal benchmark harness: benchmarks register themselves with
+// BENCHMARK(group, name) and are run by BenchMain.cpp, which can also
+// write every measurement to a JSON file
+//
+// ------------------------------------------------------------------
+namespace bench
+{
+    struct Case
+    {
+        std::string group;
+        std::string name;
+        std::function<void()> body;
+    };
+
+    std::vector<Case>& registry();
+
+    struct Registrar
+    {
+        Registrar(const char* group, const char* name, std::function<void()> body)
+        {
+            registry().push_back({ group, name, std::move(body) });
+        }
+    };
+
+    // Number of global operator new calls made so far in this process
+    std::size_t allocationCount();
+
+    // Resident set size of this process in bytes, or 0 where it cannot be read
+    std::size_t residentBytes();
+
+    // Keeps the compiler from optimizing a value away
+    template <typename T>
+    inline void doNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static const void* volatile sink;
+        sink = &value;
+#endif
+    }
+
+    // Records one measurement for the case currently running
+    void report(const std::string& metric, double value, const std::string& unit);
+
+    // Reports p50, p99, p99.9 and max of a set of latency samples in nanoseconds
+    void reportPercentiles(const std::string& metric, std::vector<double> samples);
+
+    // Runs op() iterations times and reports the average cost in nanoseconds
+    template <typename Op>
+    double timeOp(const std::string& metric, std::size_t iterations, Op&& op)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; i++)
+        {
+            op();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+        report(metric, ns, "ns/op");
+        return ns;
+    }
+
+    // Thread counts for scalability runs: 1, 2, 4, ... up to at least the core count
+    std::vector<unsigned int> threadCounts();
+
+    // Starts threads together, each calling op(threadIndex) iterations times, and
+    // reports the combined throughput in operations per second
+    template <typename Op>
+    double timeThreads(const std::string& metric, unsigned int threads, std::size_t iterations, Op&& op)
+    {
+        std::atomic<bool> go{ false };
+        std::atomic<unsigned int> ready{ 0 };
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]
+                                 {
+                                     ready++;
+                                     while (!go.load(std::memory_order_acquire))
+                                     {
+                                         std::this_thread::yield();
+                                     }
+                                     for (std::size_t i = 0; i < iterations; i++)
+                                     {
+                                         op(t);
+                                     }
+                                 });
+        }
+        while (ready.load() != threads)
+        {
+            std::this_thread::yield();
+        }
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double opsPerSecond = static_cast<double>(iterations) * threads / seconds;
+        report(metric + " @" + std::to_string(threads) + " threads", opsPerSecond / 1e6, "Mops/s");
+        return opsPerSecond;
+    }
+} // namespace bench
+
+#define BENCH_CONCAT_INNER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_INNER(a, b)
+
+#define BENCHMARK(group, name)                                                                 \
+    static void bench_##group##_##name();                                                      \
+    static bench::Registrar BENCH_CONCAT(registrar_, __LINE__)(#group, #name, bench_##group##_##name); \
+    static void bench_##group##_##name()
@@ -0,0 +1,156 @@
+// TestInstrumentation.cpp
+//
+// Built into its own runner with USU_INSTRUMENTATION defined, since the
+// switch has to be the same in every translation unit of a program
+
+#include "instrumentation.hpp"
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SharedWidget
+{
+    int value = 0;
+};
+
+struct UniqueWidget
+{
+    int value = 0;
+};
+
+struct ThreadedWidget
+{
+    int value = 0;
+};
+
+struct OverheadWidget
+{
+    int value = 0;
+};
+
+usu::instrumentation::type_counters countersFor(const std::string& type)
+{
+    for (auto& counters : usu::instrumentation::snapshot())
+    {
+        if (counters.type == type)
+        {
+            return counters;
+        }
+    }
+    return {};
+}
+
+std::uint64_t totalLifetimes(const usu::instrumentation::type_counters& counters)
+{
+    return std::accumulate(counters.lifetimes.begin(), counters.lifetimes.end(), std::uint64_t{ 0 });
+}
+
+TEST(Instrumentation, CountsSharedTraffic)
+{
+    ASSERT_TRUE(usu::instrumentation::enabled);
+    {
+        auto first = usu::make_shared<SharedWidget>();
+        auto second = usu::shared_ptr<SharedWidget>(new SharedWidget());
+        auto copy = first;
+        auto moved = std::move(copy);
+        usu::weak_ptr<SharedWidget> weak(first);
+        auto locked = weak.lock();
+
+        auto live = countersFor("SharedWidget");
+        EXPECT_EQ(live.allocations, 2u);
+        EXPECT_EQ(live.copies, 2u);
+        EXPECT_EQ(live.moves, 1u);
+        EXPECT_EQ(live.live, 2);
+    }
+    auto counters = countersFor("SharedWidget");
+    EXPECT_EQ(counters.destructions, 2u);
+    EXPECT_EQ(counters.live, 0);
+    EXPECT_EQ(counters.peakLive, 2);
+    EXPECT_EQ(totalLifetimes(counters), 2u);
+
+    // Arrays are counted apart from single objects
+    auto array = usu::make_shared_array<SharedWidget>(4);
+    EXPECT_EQ(countersFor("SharedWidget []").allocations, 1u);
+}
+
+TEST(Instrumentation, CountsUniqueTraffic)
+{
+    {
+        auto first = usu::make_unique<UniqueWidget>();
+        auto moved = std::move(first);
+        first = usu::make_unique<UniqueWidget>();
+        delete moved.release();
+        first.reset(new UniqueWidget());
+    }
+    auto counters = countersFor("UniqueWidget");
+    EXPECT_EQ(counters.allocations, 3u);
+    // The released object was deleted by hand, outside the pointers' view
+    EXPECT_EQ(counters.destructions, 2u);
+    EXPECT_EQ(counters.moves, 2u);
+    EXPECT_EQ(counters.live, 0);
+    EXPECT_EQ(counters.peakLive, 2);
+    // unique_ptr has nowhere to keep a start time
+    EXPECT_EQ(totalLifetimes(counters), 0u);
+}
+
+TEST(Instrumentation, AggregatesAcrossThreads)
+{
+    constexpr int THREADS = 4;
+    constexpr int OBJECTS = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++)
+    {
+        threads.emplace_back([]
+                             {
+                                 std::vector<usu::shared_ptr<ThreadedWidget>> owners;
+                                 for (int i = 0; i < OBJECTS; i++)
+                                 {
+                                     owners.push_back(usu::make_shared<ThreadedWidget>());
+                                 }
+                             });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    // The threads have exited, so their counters come from the retired totals
+    auto counters = countersFor("ThreadedWidget");
+    EXPECT_EQ(counters.allocations, static_cast<std::uint64_t>(THREADS * OBJECTS));
+    EXPECT_EQ(counters.destructions, static_cast<std::uint64_t>(THREADS * OBJECTS));
+    EXPECT_GE(counters.peakLive, OBJECTS);
+    EXPECT_EQ(counters.live, 0);
+}
+
+TEST(Instrumentation, Dump)
+{
+    auto keep = usu::make_shared<SharedWidget>();
+    std::ostringstream out;
+    usu::instrumentation::dump(out);
+    EXPECT_NE(out.str().find("SharedWidget: allocations"), std::string::npos);
+    EXPECT_NE(out.str().find("lived < 2^"), std::string::npos);
+}
+
+// Every copy is counted once, however many are made; the cost of the hooks
+// is measured by the Instrumentation group in the bench suite
+TEST(Instrumentation, CountsEveryCopy)
+{
+    constexpr std::size_t COPIES = 1'000'000;
+    auto source = usu::make_shared<OverheadWidget>();
+    std::size_t nonNull = 0;
+    for (std::size_t i = 0; i < COPIES; i++)
+    {
+        auto copy = source;
+        nonNull += copy.get() != nullptr;
+    }
+    EXPECT_EQ(nonNull, COPIES);
+    EXPECT_EQ(countersFor("OverheadWidget").copies, COPIES);
+    EXPECT_EQ(countersFor("OverheadWidget").live, 1);
+}
@@ -1,12 +1,38 @@
 // TestMemory.cpp
 
+#include "arena.hpp"
+#include "atomic_shared_ptr.hpp"
+#include "biased_shared_ptr.hpp"
+#include "compact_ptr.hpp"
+#include "cow_ptr.hpp"
+#include "epoch_domain.hpp"
+#include "hazard_pointer.hpp"
+#include "instrumentation.hpp"
+#include "intrusive_ptr.hpp"
+#include "mapped_array.hpp"
+#include "object_pool.hpp"
+#include "reclaimer.hpp"
+#include "relocating_vector.hpp"
+#include "sampling.hpp"
 #include "shared_ptr.hpp"
+#include "sharded_shared_ptr.hpp"
 #include "unique_ptr.hpp"
 
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <memory_resource>
+#include <source_location>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Define the MyClass used in tests
 class MyClass
@@ -136,6 +162,1306 @@ TEST(Array, CanCreateArray)
     EXPECT_EQ(primes.size(), 4u);
 }
 
+// Counts live instances so tests can check when objects are destroyed
+class Tracked
+{
+  public:
+    Tracked() { live++; }
+    ~Tracked() { live--; }
+    static inline std::atomic<int> live = 0;
+};
+
+TEST(Lifetime, MakeSharedDestroysWithLastOwner)
+{
+    {
+        auto p1 = usu::make_shared<Tracked>();
+        {
+            auto p2 = p1;
+            EXPECT_EQ(p1.use_count(), 2u);
+            EXPECT_EQ(Tracked::live.load(), 1);
+        }
+        EXPECT_EQ(p1.use_count(), 1u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Lifetime, RawPointerDestroysWithLastOwner)
+{
+    {
+        usu::shared_ptr<Tracked> p1(new Tracked());
+        auto p2 = p1;
+        EXPECT_EQ(p2.use_count(), 2u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+    usu::shared_ptr<Tracked> empty;
+    EXPECT_EQ(empty.use_count(), 0u);
+    EXPECT_EQ(empty.get(), nullptr);
+}
+
+TEST(Lifetime, ArrayDestroysWithLastOwner)
+{
+    {
+        auto a1 = usu::make_shared_array<Tracked, 3>();
+        EXPECT_EQ(Tracked::live.load(), 3);
+        auto a2 = a1;
+        EXPECT_EQ(a1.use_count(), 2u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Array, RuntimeSize)
+{
+    auto zeroed = usu::make_shared_array<int>(1000);
+    EXPECT_EQ(zeroed.size(), 1000u);
+    for (std::size_t i = 0; i < zeroed.size(); i++)
+    {
+        EXPECT_EQ(zeroed[i], 0);
+    }
+    EXPECT_THROW(zeroed[1000], std::out_of_range);
+
+    auto aligned = usu::make_shared_array<float>(3, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned.get()) % 64, 0u);
+    auto large = usu::make_shared_for_overwrite<double[]>(1 << 20, 32);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(large.get()) % 32, 0u);
+    EXPECT_THROW(usu::make_shared_array<int>(4, 48), std::runtime_error);
+
+    {
+        // Elements with constructors are still built when overwriting
+        auto objects = usu::make_shared_for_overwrite<Tracked[]>(5, 64);
+        EXPECT_EQ(Tracked::live.load(), 5);
+        auto copy = objects;
+        EXPECT_EQ(objects.use_count(), 2u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Array, SlicesShareTheBuffer)
+{
+    usu::shared_ptr<int[]> chunk;
+    {
+        auto buffer = usu::make_shared_array<int>(100);
+        for (std::size_t i = 0; i < buffer.size(); i++)
+        {
+            buffer[i] = static_cast<int>(i);
+        }
+        chunk = buffer.slice(40, 20);
+        EXPECT_EQ(buffer.use_count(), 2u);
+        EXPECT_EQ(chunk.size(), 20u);
+        EXPECT_EQ(chunk[0], 40);
+        EXPECT_THROW(chunk[20], std::out_of_range);
+        EXPECT_THROW(buffer.slice(90, 11), std::out_of_range);
+
+        // Writes through a slice are seen by the parent
+        chunk[1] = -1;
+        EXPECT_EQ(buffer[41], -1);
+        EXPECT_EQ(chunk.slice(19, 1)[0], 59);
+        EXPECT_EQ(buffer.slice(100, 0).size(), 0u);
+    }
+    // The slice keeps the whole buffer alive
+    EXPECT_EQ(chunk.use_count(), 1u);
+    int total = 0;
+    for (int value : chunk.span())
+    {
+        total += value;
+    }
+    EXPECT_EQ(total, (40 + 59) * 20 / 2 - 41 - 1);
+}
+
+TEST(Array, AliasingConstructor)
+{
+    {
+        auto objects = usu::make_shared_array<Tracked>(4);
+        usu::shared_ptr<Tracked> third(objects, &objects[2]);
+        usu::shared_ptr<Tracked[]> tail(objects, objects.get() + 2, 2);
+        objects = usu::shared_ptr<Tracked[]>();
+        EXPECT_EQ(Tracked::live.load(), 4);
+        EXPECT_EQ(third.get(), tail.get());
+        EXPECT_EQ(tail.use_count(), 2u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Array, UniqueArrays)
+{
+    auto zeroed = usu::make_unique<int[]>(8);
+    EXPECT_EQ(zeroed[7], 0);
+
+    auto aligned = usu::make_unique_array<int>(100, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned.get()) % 64, 0u);
+    EXPECT_EQ(aligned.get_deleter().size(), 100u);
+    aligned[99] = 5;
+    EXPECT_EQ(aligned[99], 5);
+
+    {
+        auto objects = usu::make_unique_for_overwrite<Tracked[]>(4, 32);
+        EXPECT_EQ(Tracked::live.load(), 4);
+        auto moved = std::move(objects);
+        EXPECT_EQ(objects.get(), nullptr);
+        EXPECT_THROW(objects[0], std::runtime_error);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Array, AccessPolicies)
+{
+    auto values = usu::make_shared_array<int>(4);
+    values.element<usu::unchecked_access>(2) = 7;
+    EXPECT_EQ(values.element<usu::checked_access>(2), 7);
+    EXPECT_EQ(values.element<usu::assert_access>(2), 7);
+    EXPECT_THROW(values.element<usu::checked_access>(4), std::out_of_range);
+
+    usu::shared_ptr<int[]> empty;
+    EXPECT_THROW(empty.element<usu::checked_access>(0), std::runtime_error);
+
+    auto unique = usu::make_unique<int[]>(4);
+    unique.element<usu::unchecked_access>(3) = 9;
+    EXPECT_EQ(unique[3], 9);
+
+    // The default policy is checked unless the build opts out
+    EXPECT_TRUE((std::is_same_v<usu::default_access, usu::checked_access>));
+    EXPECT_THROW(values[4], std::out_of_range);
+}
+
+#if __has_include(<sys/mman.h>)
+// Writes count consecutive ints to a fresh file in the temp directory
+std::string writeIntFile(const char* name, int count)
+{
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    for (int i = 0; i < count; i++)
+    {
+        out.write(reinterpret_cast<const char*>(&i), sizeof(i));
+    }
+    return path;
+}
+
+TEST(MappedArray, ReadOnly)
+{
+    auto path = writeIntFile("usu_mapped_read.bin", 1000);
+    usu::shared_ptr<const int[]> tail;
+    {
+        auto table = usu::map_shared_array<const int>(path, usu::map_mode::read_only, { usu::map_advice::random, true, false });
+        EXPECT_EQ(table.size(), 1000u);
+        EXPECT_EQ(table[999], 999);
+        tail = table.slice(900, 100);
+    }
+    // The slice keeps the mapping alive after the table is gone
+    EXPECT_EQ(tail[0], 900);
+    EXPECT_THROW(usu::map_shared_array<int>(path), std::runtime_error);
+    EXPECT_THROW(usu::map_shared_array<const int>(path + ".missing"), std::system_error);
+    EXPECT_THROW(usu::map_shared_array<const double>(writeIntFile("usu_mapped_odd.bin", 3)), std::runtime_error);
+    EXPECT_EQ(usu::map_shared_array<const int>(writeIntFile("usu_mapped_empty.bin", 0)).size(), 0u);
+    for (const char* name : { "usu_mapped_read.bin", "usu_mapped_odd.bin", "usu_mapped_empty.bin" })
+    {
+        std::filesystem::remove(std::filesystem::temp_directory_path() / name);
+    }
+}
+
+TEST(MappedArray, WritableModes)
+{
+    auto path = writeIntFile("usu_mapped_write.bin", 16);
+    {
+        auto privateCopy = usu::map_shared_array<int>(path, usu::map_mode::copy_on_write);
+        privateCopy[0] = -1;
+        auto shared = usu::map_shared_array<int>(path, usu::map_mode::read_write);
+        EXPECT_EQ(shared[0], 0);
+        shared[1] = -2;
+    }
+    // Only the shared mapping's write reaches the file
+    auto reread = usu::map_shared_array<const int>(path);
+    EXPECT_EQ(reread[0], 0);
+    EXPECT_EQ(reread[1], -2);
+    std::filesystem::remove(path);
+}
+#endif
+
+TEST(Threading, ConcurrentCopyAndDestroy)
+{
+    constexpr int THREADS = 8;
+    constexpr int COPIES = 20000;
+    {
+        auto shared = usu::make_shared<Tracked>();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < THREADS; t++)
+        {
+            workers.emplace_back([&shared]
+                                 {
+                                     std::vector<usu::shared_ptr<Tracked>> copies;
+                                     for (int i = 0; i < COPIES; i++)
+                                     {
+                                         copies.emplace_back(shared);
+                                         if (copies.size() == 16)
+                                         {
+                                             copies.clear();
+                                         }
+                                     }
+                                 });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        EXPECT_EQ(shared.use_count(), 1u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Threading, LastOwnerOnAnotherThreadDestroys)
+{
+    {
+        auto shared = usu::make_shared<Tracked>();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; t++)
+        {
+            workers.emplace_back([copy = shared]() mutable
+                                 { copy = usu::shared_ptr<Tracked>(); });
+        }
+        shared = usu::shared_ptr<Tracked>();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Threading, LocalSharedPtr)
+{
+    {
+        usu::local_shared_ptr<Tracked> p1 = usu::make_shared<Tracked, usu::thread_unsafe_counter>();
+        auto p2 = p1;
+        EXPECT_EQ(p1.use_count(), 2u);
+        auto a1 = usu::make_shared_array<int, 4, usu::thread_unsafe_counter>();
+        EXPECT_EQ(a1.use_count(), 1u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(WeakPtr, LockAndExpire)
+{
+    usu::weak_ptr<Tracked> weak;
+    EXPECT_TRUE(weak.expired());
+    {
+        auto shared = usu::make_shared<Tracked>();
+        weak = usu::weak_ptr<Tracked>(shared);
+        EXPECT_FALSE(weak.expired());
+        EXPECT_EQ(weak.use_count(), 1u);
+        auto locked = weak.lock();
+        EXPECT_EQ(locked.get(), shared.get());
+        EXPECT_EQ(shared.use_count(), 2u);
+    }
+    // The object is gone even though the weak reference keeps the storage
+    EXPECT_EQ(Tracked::live.load(), 0);
+    EXPECT_TRUE(weak.expired());
+    EXPECT_EQ(weak.lock().get(), nullptr);
+}
+
+TEST(WeakPtr, OutlivesRawPointerOwner)
+{
+    usu::shared_ptr<Tracked> shared(new Tracked());
+    usu::weak_ptr<Tracked> weak(shared);
+    usu::weak_ptr<Tracked> weakCopy = weak;
+    shared = usu::shared_ptr<Tracked>();
+    EXPECT_EQ(Tracked::live.load(), 0);
+    EXPECT_TRUE(weakCopy.expired());
+}
+
+class Callback : public usu::enable_shared_from_this<Callback>
+{
+  public:
+    usu::shared_ptr<Callback> handle() { return shared_from_this(); }
+};
+
+TEST(WeakPtr, SharedFromThis)
+{
+    auto callback = usu::make_shared<Callback>();
+    auto handle = callback->handle();
+    EXPECT_EQ(handle.get(), callback.get());
+    EXPECT_EQ(callback.use_count(), 2u);
+
+    usu::shared_ptr<Callback> adopted(new Callback());
+    EXPECT_EQ(adopted->handle().get(), adopted.get());
+
+    Callback unowned;
+    EXPECT_THROW(unowned.handle(), std::runtime_error);
+}
+
+TEST(AtomicSharedPtr, LoadStoreExchange)
+{
+    usu::atomic_shared_ptr<int> atomic;
+    EXPECT_TRUE(atomic.is_lock_free());
+    EXPECT_EQ(atomic.load().get(), nullptr);
+
+    auto first = usu::make_shared<int>(1);
+    atomic.store(first);
+    EXPECT_EQ(atomic.load().get(), first.get());
+    EXPECT_EQ(first.use_count(), 2u);
+
+    auto previous = atomic.exchange(usu::make_shared<int>(2));
+    EXPECT_EQ(previous.get(), first.get());
+    EXPECT_EQ(*atomic.load(), 2);
+    EXPECT_EQ(first.use_count(), 2u);
+    previous = usu::shared_ptr<int>();
+    EXPECT_EQ(first.use_count(), 1u);
+}
+
+TEST(AtomicSharedPtr, CompareExchange)
+{
+    auto first = usu::make_shared<int>(1);
+    auto second = usu::make_shared<int>(2);
+    usu::atomic_shared_ptr<int> atomic(first);
+
+    auto expected = second;
+    EXPECT_FALSE(atomic.compare_exchange_strong(expected, second));
+    EXPECT_EQ(expected.get(), first.get());
+
+    EXPECT_TRUE(atomic.compare_exchange_strong(expected, second));
+    EXPECT_EQ(atomic.load().get(), second.get());
+    EXPECT_EQ(first.use_count(), 2u);
+
+    expected = second;
+    while (!atomic.compare_exchange_weak(expected, first))
+    {
+    }
+    EXPECT_EQ(atomic.load().get(), first.get());
+}
+
+TEST(AtomicSharedPtr, ConcurrentReadersAndWriters)
+{
+    constexpr int READERS = 4;
+    constexpr int READS = 20000;
+    {
+        usu::atomic_shared_ptr<Tracked> atomic(usu::make_shared<Tracked>());
+        std::atomic<bool> done{ false };
+        std::thread writer([&]
+                           {
+                               while (!done.load())
+                               {
+                                   atomic.store(usu::make_shared<Tracked>());
+                                   auto expected = atomic.load();
+                                   atomic.compare_exchange_strong(expected, usu::make_shared<Tracked>());
+                               }
+                           });
+        std::vector<std::thread> readers;
+        for (int t = 0; t < READERS; t++)
+        {
+            readers.emplace_back([&]
+                                 {
+                                     for (int i = 0; i < READS; i++)
+                                     {
+                                         auto current = atomic.load();
+                                         EXPECT_NE(current.get(), nullptr);
+                                     }
+                                 });
+        }
+        for (auto& reader : readers)
+        {
+            reader.join();
+        }
+        done = true;
+        writer.join();
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(ShardedSharedPtr, CountsAcrossShards)
+{
+    {
+        auto sharded = usu::make_sharded_shared<Tracked, 4>();
+        auto copy = sharded;
+        EXPECT_EQ(sharded.use_count(), 2u);
+        std::thread other([&sharded]
+                          {
+                              auto local = sharded;
+                              EXPECT_EQ(local.get(), sharded.get());
+                          });
+        other.join();
+        EXPECT_EQ(sharded.use_count(), 2u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(ShardedSharedPtr, LastOwnerOnAnotherThreadDestroys)
+{
+    constexpr int THREADS = 8;
+    {
+        auto sharded = usu::make_sharded_shared<Tracked>();
+        std::vector<usu::sharded_shared_ptr<Tracked>> handles;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < THREADS; t++)
+        {
+            workers.emplace_back([&sharded]
+                                 {
+                                     for (int i = 0; i < 10000; i++)
+                                     {
+                                         auto copy = sharded;
+                                         auto second = copy;
+                                     }
+                                 });
+            // Handles created here count in this thread's shard but die elsewhere
+            handles.push_back(sharded);
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        std::thread destroyer([moved = std::move(handles)] {});
+        destroyer.join();
+        EXPECT_EQ(sharded.use_count(), 1u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(BiasedSharedPtr, OwnerThreadCounts)
+{
+    {
+        auto biased = usu::make_biased_shared<Tracked>();
+        {
+            auto copy = biased;
+            EXPECT_EQ(biased.use_count(), 2u);
+        }
+        EXPECT_EQ(biased.use_count(), 1u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(BiasedSharedPtr, HandlesEscapeToOtherThreads)
+{
+    {
+        auto biased = usu::make_biased_shared<Tracked>();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; t++)
+        {
+            // Copied on the owner thread, destroyed on the worker
+            workers.emplace_back([copy = biased]
+                                 {
+                                     for (int i = 0; i < 1000; i++)
+                                     {
+                                         auto local = copy;
+                                         EXPECT_NE(local.get(), nullptr);
+                                     }
+                                 });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        EXPECT_EQ(biased.use_count(), 1u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(BiasedSharedPtr, OwnerLetsGoFirst)
+{
+    usu::biased_shared_ptr<Tracked> escaped;
+    std::thread owner([&escaped]
+                      {
+                          auto biased = usu::make_biased_shared<Tracked>();
+                          escaped = biased;
+                      });
+    owner.join();
+    EXPECT_EQ(Tracked::live.load(), 1);
+    escaped = usu::biased_shared_ptr<Tracked>();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(BiasedSharedPtr, OwnerThreadExitsWhileShared)
+{
+    usu::biased_shared_ptr<Tracked> escaped;
+    std::thread owner([&escaped]
+                      { escaped = usu::make_biased_shared<Tracked>(); });
+    owner.join();
+    auto copy = escaped;
+    escaped = usu::biased_shared_ptr<Tracked>();
+    EXPECT_EQ(Tracked::live.load(), 1);
+    copy = usu::biased_shared_ptr<Tracked>();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+// Forwards to std::allocator and counts what is still outstanding
+template <typename T>
+class CountingAllocator
+{
+  public:
+    using value_type = T;
+
+    explicit CountingAllocator(int* outstanding) :
+        outstanding(outstanding)
+    {
+    }
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) :
+        outstanding(other.outstanding)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        (*outstanding)++;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* ptr, std::size_t n)
+    {
+        (*outstanding)--;
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    int* outstanding;
+};
+
+TEST(Allocator, PoolReusesFreedBlocks)
+{
+    void* first = usu::make_shared<int>(1).get();
+    void* second = usu::make_shared<int>(2).get();
+    EXPECT_EQ(first, second);
+}
+
+TEST(Allocator, FreedOnAnotherThread)
+{
+    std::vector<usu::shared_ptr<Tracked>> made;
+    std::thread maker([&made]
+                      {
+                          for (int i = 0; i < 1000; i++)
+                          {
+                              made.emplace_back(usu::make_shared<Tracked>());
+                          }
+                      });
+    maker.join();
+    EXPECT_EQ(Tracked::live.load(), 1000);
+    made.clear();
+    EXPECT_EQ(Tracked::live.load(), 0);
+
+    // The next thread takes over the exited thread's pool, remote frees included
+    std::thread reuser([]
+                       {
+                           for (int i = 0; i < 2000; i++)
+                           {
+                               usu::make_shared<Tracked>();
+                           }
+                       });
+    reuser.join();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Allocator, AllocateShared)
+{
+    int outstanding = 0;
+    usu::weak_ptr<Tracked> weak;
+    {
+        auto shared = usu::allocate_shared<Tracked>(CountingAllocator<Tracked>(&outstanding));
+        weak = shared;
+        EXPECT_EQ(outstanding, 1);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+    EXPECT_EQ(outstanding, 1);
+    weak.reset();
+    EXPECT_EQ(outstanding, 0);
+}
+
+TEST(Allocator, AllocateUnique)
+{
+    int outstanding = 0;
+    {
+        auto unique = usu::allocate_unique<std::string>(CountingAllocator<char>(&outstanding), "pooled");
+        EXPECT_EQ(*unique, "pooled");
+        EXPECT_EQ(outstanding, 1);
+    }
+    EXPECT_EQ(outstanding, 0);
+
+    auto pooled = usu::allocate_unique<Tracked>(usu::pool_allocator<Tracked>());
+    EXPECT_EQ(Tracked::live.load(), 1);
+    pooled.reset();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Allocator, SharedPtrDeleter)
+{
+    static_assert(sizeof(usu::shared_ptr<int>) == 2 * sizeof(int*));
+    int deleted = 0;
+    usu::weak_ptr<Tracked> watcher;
+    {
+        usu::shared_ptr<Tracked> owner(new Tracked(), [&deleted](Tracked* object)
+                                       {
+                                           deleted++;
+                                           delete object;
+                                       });
+        watcher = usu::weak_ptr<Tracked>(owner);
+        auto copy = owner;
+        EXPECT_EQ(deleted, 0);
+    }
+    EXPECT_EQ(deleted, 1);
+    EXPECT_EQ(Tracked::live.load(), 0);
+    EXPECT_TRUE(watcher.expired());
+
+    // A null pointer owns nothing, so the deleter never sees it
+    usu::shared_ptr<int> empty(nullptr, [&deleted](int*)
+                               { deleted++; });
+    EXPECT_EQ(empty.use_count(), 0u);
+    empty = usu::shared_ptr<int>();
+    EXPECT_EQ(deleted, 1);
+
+    {
+        int storage[4] = { 1, 2, 3, 4 };
+        usu::shared_ptr<int[]> borrowed(storage, 4, [&deleted](int*)
+                                        { deleted++; });
+        EXPECT_EQ(borrowed[3], 4);
+    }
+    EXPECT_EQ(deleted, 2);
+}
+
+TEST(Allocator, SharedPtrDeleterAndAllocator)
+{
+    int outstanding = 0;
+    {
+        usu::shared_ptr<Tracked> owner(new Tracked(), usu::default_delete<Tracked>(), CountingAllocator<Tracked>(&outstanding));
+        // The control block, with the deleter inside it, is the only allocation
+        EXPECT_EQ(outstanding, 1);
+        usu::weak_ptr<Tracked> watcher(owner);
+        owner = usu::shared_ptr<Tracked>();
+        EXPECT_EQ(Tracked::live.load(), 0);
+        EXPECT_EQ(outstanding, 1);
+    }
+    EXPECT_EQ(outstanding, 0);
+}
+
+TEST(Arena, DestroyWithOwner)
+{
+    usu::arena requestArena;
+    auto shared = usu::make_shared<Tracked>(requestArena);
+    auto unique = usu::make_unique<Tracked>(requestArena);
+    EXPECT_EQ(Tracked::live.load(), 2);
+    shared = usu::shared_ptr<Tracked>();
+    unique.reset();
+    EXPECT_EQ(Tracked::live.load(), 0);
+    requestArena.reset();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Arena, DestroyAtReset)
+{
+    usu::arena requestArena(usu::arena_teardown::at_reset);
+    {
+        auto shared = usu::make_shared<Tracked>(requestArena);
+        auto unique = usu::make_unique<Tracked>(requestArena);
+        auto number = usu::make_shared<int>(requestArena, 7);
+        EXPECT_EQ(*number.get(), 7);
+    }
+    EXPECT_EQ(Tracked::live.load(), 2);
+    requestArena.reset();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+// Counts the chunks an arena takes from upstream, and can refuse them
+class CountingResource : public std::pmr::memory_resource
+{
+  public:
+    int allocations = 0;
+    // Allocations beyond this many throw; negative allows any number
+    int limit = -1;
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (limit >= 0 && allocations >= limit)
+        {
+            throw std::bad_alloc();
+        }
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+TEST(Arena, ReusesMemoryAfterReset)
+{
+    CountingResource upstream;
+    usu::arena requestArena(usu::arena_teardown::with_owner, 1024, &upstream);
+    for (int i = 0; i < 1000; i++)
+    {
+        usu::make_unique<int>(requestArena, i);
+    }
+    int firstRound = upstream.allocations;
+    EXPECT_GT(firstRound, 1);
+
+    // The newest chunk is kept and is large enough for the same request again
+    requestArena.reset();
+    for (int i = 0; i < 1000; i++)
+    {
+        usu::make_unique<int>(requestArena, i);
+    }
+    EXPECT_EQ(upstream.allocations, firstRound);
+}
+
+TEST(Arena, DestroysObjectWhenRegisteringFails)
+{
+    // A chunk only just big enough for the object leaves no room to register it
+    CountingResource upstream;
+    upstream.limit = 1;
+    usu::arena requestArena(usu::arena_teardown::at_reset, 1, &upstream);
+    EXPECT_THROW(usu::make_unique<Tracked>(requestArena), std::bad_alloc);
+    EXPECT_EQ(upstream.allocations, 1);
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Arena, MemoryResource)
+{
+    std::pmr::monotonic_buffer_resource resource;
+    auto shared = usu::make_shared<Tracked>(&resource);
+    auto unique = usu::make_unique<std::string>(&resource, "pooled");
+    EXPECT_EQ(Tracked::live.load(), 1);
+    EXPECT_EQ(*unique, "pooled");
+    shared = usu::shared_ptr<Tracked>();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Reclaimer, DrainRunsDestructors)
+{
+    usu::reclaimer deferred;
+    auto shared = usu::make_shared_deferred<Tracked>(deferred);
+    usu::weak_ptr<Tracked> weak(shared);
+    shared = usu::shared_ptr<Tracked>();
+    EXPECT_TRUE(weak.expired());
+    EXPECT_EQ(Tracked::live.load(), 1);
+    EXPECT_EQ(deferred.drain(), 1u);
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Reclaimer, FullQueueDestroysInline)
+{
+    usu::reclaimer deferred(2);
+    {
+        auto a = usu::make_shared_deferred<Tracked>(deferred);
+        auto b = usu::make_shared_deferred<Tracked>(deferred);
+        auto c = usu::make_shared_deferred<Tracked>(deferred);
+    }
+    EXPECT_EQ(deferred.overflows(), 1u);
+    EXPECT_EQ(Tracked::live.load(), 2);
+    deferred.drain();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Reclaimer, BackgroundThread)
+{
+    usu::reclaimer deferred(64);
+    deferred.start();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.emplace_back([&deferred]
+                             {
+                                 for (int i = 0; i < 1000; i++)
+                                 {
+                                     usu::make_shared_deferred<Tracked>(deferred);
+                                     usu::unique_ptr<Tracked, usu::deferred_delete<Tracked>> unique(new Tracked(), usu::deferred_delete<Tracked>(deferred));
+                                 }
+                             });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    deferred.stop();
+    deferred.drain();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(Reclaimer, DeferredDelete)
+{
+    usu::reclaimer deferred;
+    usu::unique_ptr<Tracked, usu::deferred_delete<Tracked>> unique(new Tracked(), usu::deferred_delete<Tracked>(deferred));
+    unique.reset();
+    EXPECT_EQ(Tracked::live.load(), 1);
+    deferred.drain();
+    EXPECT_EQ(Tracked::live.load(), 0);
+
+    // The default reclaimer drains on its own thread
+    auto shared = usu::make_shared_deferred<int>(42);
+    EXPECT_EQ(*shared.get(), 42);
+}
+
+TEST(EpochDomain, RetiredNodeOutlivesGuard)
+{
+    usu::epoch_domain domain;
+    {
+        usu::epoch_domain::guard guard(domain);
+        domain.retire(usu::unique_ptr<Tracked>(new Tracked()));
+        EXPECT_EQ(domain.collect(), 1u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(domain.collect(), 0u);
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(EpochDomain, DomainFreesWhatIsLeft)
+{
+    {
+        usu::epoch_domain domain;
+        usu::epoch_domain::guard guard(domain);
+        domain.retire(usu::unique_ptr<Tracked>(new Tracked()));
+    }
+    std::thread([]
+                {
+                    usu::epoch_domain domain;
+                    domain.retire(usu::unique_ptr<Tracked>(new Tracked()));
+                })
+        .join();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+// Retires the rest of its chain when it is freed, as a tree node would its children
+struct EpochChainNode
+{
+    ~EpochChainNode()
+    {
+        if (next)
+        {
+            domain->retire(usu::unique_ptr<EpochChainNode>(next));
+        }
+    }
+
+    Tracked payload;
+    usu::epoch_domain* domain = nullptr;
+    EpochChainNode* next = nullptr;
+};
+
+TEST(EpochDomain, DestructorRetiresMore)
+{
+    usu::epoch_domain domain;
+    EpochChainNode* head = nullptr;
+    for (int i = 0; i < 1000; i++)
+    {
+        head = new EpochChainNode{ {}, &domain, head };
+    }
+    // Wide enough that one collection frees many nodes, each retiring another
+    for (int i = 0; i < 200; i++)
+    {
+        domain.retire(usu::unique_ptr<EpochChainNode>(new EpochChainNode{ {}, &domain, new EpochChainNode{ {}, &domain, nullptr } }));
+    }
+    domain.retire(usu::unique_ptr<EpochChainNode>(head));
+    for (int round = 0; round < 2000 && domain.collect() != 0; round++)
+    {
+    }
+    EXPECT_EQ(domain.collect(), 0u);
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(EpochDomain, LockFreeStack)
+{
+    struct Node
+    {
+        Tracked payload;
+        Node* next = nullptr;
+    };
+    {
+        usu::epoch_domain domain;
+        std::atomic<Node*> head{ nullptr };
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; t++)
+        {
+            workers.emplace_back([&]
+                                 {
+                                     for (int i = 0; i < 5000; i++)
+                                     {
+                                         auto node = new Node();
+                                         node->next = head.load(std::memory_order_relaxed);
+                                         while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+                                         {
+                                         }
+
+                                         usu::epoch_domain::guard guard(domain);
+                                         Node* top = head.load(std::memory_order_acquire);
+                                         while (top && !head.compare_exchange_weak(top, top->next, std::memory_order_acquire, std::memory_order_acquire))
+                                         {
+                                         }
+                                         if (top)
+                                         {
+                                             domain.retire(usu::unique_ptr<Node>(top));
+                                         }
+                                     }
+                                 });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        EXPECT_EQ(head.load(), nullptr);
+    }
+    // Exited threads leave their retire lists to the domain, which frees them last
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(HazardPointer, ProtectedObjectSurvivesRetire)
+{
+    usu::hazard_domain domain;
+    std::atomic<Tracked*> source{ new Tracked() };
+    usu::hazard_pointer hazard(domain);
+    Tracked* read = hazard.protect(source);
+    source.store(nullptr);
+    domain.retire(usu::unique_ptr<Tracked>(read));
+    EXPECT_EQ(domain.collect(), 1u);
+    EXPECT_EQ(Tracked::live.load(), 1);
+    hazard.reset();
+    EXPECT_EQ(domain.collect(), 0u);
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+// Retires the rest of its chain when it is freed, as a tree node would its children
+struct HazardChainNode
+{
+    ~HazardChainNode()
+    {
+        if (next)
+        {
+            domain->retire(usu::unique_ptr<HazardChainNode>(next));
+        }
+    }
+
+    Tracked payload;
+    usu::hazard_domain* domain = nullptr;
+    HazardChainNode* next = nullptr;
+};
+
+TEST(HazardPointer, DestructorRetiresMore)
+{
+    usu::hazard_domain domain;
+    for (int i = 0; i < 200; i++)
+    {
+        domain.retire(usu::unique_ptr<HazardChainNode>(new HazardChainNode{ {}, &domain, new HazardChainNode{ {}, &domain, nullptr } }));
+    }
+    for (int round = 0; round < 10 && domain.collect() != 0; round++)
+    {
+    }
+    EXPECT_EQ(domain.collect(), 0u);
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(HazardPointer, SlotsRunOut)
+{
+    usu::hazard_domain domain;
+    {
+        usu::hazard_pointer a(domain), b(domain), c(domain), d(domain);
+        EXPECT_THROW(usu::hazard_pointer extra(domain), std::runtime_error);
+    }
+    usu::hazard_pointer again(domain);
+}
+
+TEST(HazardPointer, ReadersAndWriter)
+{
+    struct Entry
+    {
+        Tracked payload;
+        int value = 42;
+    };
+    {
+        usu::hazard_domain domain;
+        std::atomic<Entry*> current{ new Entry() };
+        std::atomic<bool> done{ false };
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; t++)
+        {
+            readers.emplace_back([&]
+                                 {
+                                     usu::hazard_pointer hazard(domain);
+                                     while (!done.load())
+                                     {
+                                         EXPECT_EQ(hazard.protect(current)->value, 42);
+                                     }
+                                 });
+        }
+        for (int i = 0; i < 2000; i++)
+        {
+            domain.retire(usu::unique_ptr<Entry>(current.exchange(new Entry())));
+        }
+        done = true;
+        for (auto& reader : readers)
+        {
+            reader.join();
+        }
+        delete current.load();
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(ObjectPool, RecyclesObjects)
+{
+    {
+        usu::object_pool<std::vector<int>> pool([](std::vector<int>& buffer)
+                                                { buffer.clear(); });
+        int* storage = nullptr;
+        {
+            auto buffer = pool.acquire();
+            buffer->assign(1000, 7);
+            storage = buffer->data();
+        }
+        // The same object comes back, cleared but with its capacity intact
+        auto again = pool.acquire();
+        EXPECT_TRUE(again->empty());
+        EXPECT_GE(again->capacity(), 1000u);
+        EXPECT_EQ(again->data(), storage);
+        auto second = pool.acquire();
+        EXPECT_EQ(pool.constructed(), 2u);
+    }
+
+    // Idle objects are deleted with the pool
+    {
+        usu::object_pool<Tracked> pool;
+        pool.acquire();
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(ObjectPool, MovesBetweenThreads)
+{
+    usu::object_pool<Tracked> pool(nullptr, []
+                                   { return usu::make_unique<Tracked>(); });
+    std::vector<usu::pool_ptr<Tracked>> handed;
+    for (int i = 0; i < 100; i++)
+    {
+        handed.push_back(pool.acquire());
+    }
+    // Another thread releases them all, spilling past its own cache...
+    std::thread([&]
+                { handed.clear(); })
+        .join();
+    // ...so this thread reuses them instead of building more
+    for (int i = 0; i < 100; i++)
+    {
+        handed.push_back(pool.acquire());
+    }
+    EXPECT_LE(pool.constructed(), 100u + usu::object_pool<Tracked>::CACHE);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.emplace_back([&pool]
+                             {
+                                 for (int i = 0; i < 10000; i++)
+                                 {
+                                     auto object = pool.acquire();
+                                 }
+                             });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    handed.clear();
+    EXPECT_EQ(Tracked::live.load(), static_cast<int>(pool.constructed()));
+}
+
+class Counted : public usu::intrusive_ref_counter<Counted>
+{
+  public:
+    Tracked payload;
+    usu::intrusive_ptr<Counted> next;
+};
+
+class LocalCounted : public usu::intrusive_ref_counter<LocalCounted, usu::thread_unsafe_counter>
+{
+  public:
+    Tracked payload;
+};
+
+TEST(IntrusivePtr, CountsLiveInTheObject)
+{
+    static_assert(sizeof(usu::intrusive_ptr<Counted>) == sizeof(Counted*));
+    {
+        auto first = usu::make_intrusive<Counted>();
+        EXPECT_EQ(first->use_count(), 1u);
+        usu::intrusive_ptr<Counted> second = first;
+        EXPECT_EQ(first->use_count(), 2u);
+
+        // A raw pointer can be turned back into an owner
+        usu::intrusive_ptr<Counted> third(first.get());
+        EXPECT_EQ(first->use_count(), 3u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+
+    auto local = usu::make_intrusive<LocalCounted>();
+    auto copy = local;
+    EXPECT_EQ(copy->use_count(), 2u);
+    local.reset();
+    copy = usu::intrusive_ptr<LocalCounted>();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(IntrusivePtr, AssignFromOwnedMember)
+{
+    auto head = usu::make_intrusive<Counted>();
+    head->next = usu::make_intrusive<Counted>();
+    head = head->next;
+    EXPECT_EQ(Tracked::live.load(), 1);
+    EXPECT_EQ(head->use_count(), 1u);
+    head.reset();
+    EXPECT_EQ(Tracked::live.load(), 0);
+}
+
+TEST(IntrusivePtr, SharedAcrossThreads)
+{
+    auto shared = usu::make_intrusive<Counted>();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.emplace_back([shared]
+                             {
+                                 for (int i = 0; i < 10000; i++)
+                                 {
+                                     usu::intrusive_ptr<Counted> copy = shared;
+                                 }
+                             });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    EXPECT_EQ(shared->use_count(), 1u);
+}
+
+TEST(Relocation, MoveSemantics)
+{
+    static_assert(std::is_nothrow_copy_constructible_v<usu::shared_ptr<int>>);
+    static_assert(std::is_nothrow_move_constructible_v<usu::shared_ptr<int>>);
+    static_assert(std::is_nothrow_move_assignable_v<usu::shared_ptr<int>>);
+    static_assert(std::is_nothrow_move_constructible_v<usu::unique_ptr<int>>);
+    static_assert(usu::is_trivially_relocatable_v<usu::shared_ptr<int>>);
+    static_assert(usu::is_trivially_relocatable_v<usu::shared_ptr<int[]>>);
+    static_assert(usu::is_trivially_relocatable_v<usu::unique_ptr<int>>);
+    static_assert(usu::is_trivially_relocatable_v<usu::intrusive_ptr<Counted>>);
+    static_assert(!usu::is_trivially_relocatable_v<std::string>);
+
+    struct Node
+    {
+        Tracked payload;
+        usu::shared_ptr<Node> next;
+    };
+    auto head = usu::make_shared<Node>();
+    head->next = usu::make_shared<Node>();
+    const auto second = head->next;
+    EXPECT_EQ(second.use_count(), 2u);
+
+    // Moving out of a member of the object being released
+    head = std::move(head->next);
+    EXPECT_EQ(Tracked::live.load(), 1);
+    EXPECT_EQ(head.use_count(), 2u);
+    head = second;
+    EXPECT_EQ(head.use_count(), 2u);
+}
+
+// Array elements that own the next array, for assigning from inside the old one
+struct ArrayNode
+{
+    Tracked payload;
+    usu::shared_ptr<ArrayNode[]> next;
+};
+
+TEST(Relocation, ArrayAssignFromOwnedElement)
+{
+    auto moved = usu::make_shared_array<ArrayNode>(1);
+    moved[0].next = usu::make_shared_array<ArrayNode>(2);
+    moved = std::move(moved[0].next);
+    EXPECT_EQ(Tracked::live.load(), 2);
+    EXPECT_EQ(moved.use_count(), 1u);
+    EXPECT_EQ(moved.size(), 2u);
+
+    auto copied = usu::make_shared_array<ArrayNode>(1);
+    copied[0].next = usu::make_shared_array<ArrayNode>(3);
+    copied = copied[0].next;
+    EXPECT_EQ(Tracked::live.load(), 5);
+    EXPECT_EQ(copied.use_count(), 1u);
+    EXPECT_EQ(copied.size(), 3u);
+}
+
+// Unique owners of the next node or array, for replacing a pointer from inside its own object
+struct UniqueNode
+{
+    Tracked payload;
+    usu::unique_ptr<UniqueNode> next;
+};
+
+struct UniqueArrayNode
+{
+    Tracked payload;
+    usu::unique_ptr<UniqueArrayNode[]> next;
+};
+
+TEST(Relocation, UniqueAssignFromOwnedMember)
+{
+    auto head = usu::make_unique<UniqueNode>();
+    head->next = usu::make_unique<UniqueNode>();
+    head->next->next = usu::make_unique<UniqueNode>();
+    UniqueNode* third = head->next->next.get();
+    head = std::move(head->next);
+    EXPECT_EQ(Tracked::live.load(), 2);
+    EXPECT_EQ(head->next.get(), third);
+    head.reset(head->next.release());
+    EXPECT_EQ(Tracked::live.load(), 1);
+    EXPECT_EQ(head.get(), third);
+
+    auto array = usu::make_unique<UniqueArrayNode[]>(1);
+    array[0].next = usu::make_unique<UniqueArrayNode[]>(2);
+    UniqueArrayNode* second = array[0].next.get();
+    array = std::move(array[0].next);
+    EXPECT_EQ(Tracked::live.load(), 3);
+    EXPECT_EQ(array.get(), second);
+    array[1].next = usu::make_unique<UniqueArrayNode[]>(1);
+    array.reset(array[1].next.release());
+    EXPECT_EQ(Tracked::live.load(), 2);
+}
+
+TEST(Relocation, RelocatingVector)
+{
+    auto shared = usu::make_shared<int>(7);
+    {
+        usu::relocating_vector<usu::shared_ptr<int>> pointers;
+        for (int i = 0; i < 1000; i++)
+        {
+            pointers.push_back(shared);
+        }
+        EXPECT_EQ(shared.use_count(), 1001u);
+        EXPECT_GE(pointers.capacity(), 1000u);
+
+        // Growing while copying one of its own elements
+        while (pointers.size() < pointers.capacity())
+        {
+            pointers.emplace_back();
+        }
+        pointers.push_back(pointers[0]);
+        EXPECT_EQ(*pointers[pointers.size() - 1], 7);
+        EXPECT_EQ(shared.use_count(), 1002u);
+
+        pointers.pop_back();
+        EXPECT_EQ(shared.use_count(), 1001u);
+        EXPECT_THROW(pointers[pointers.size()], std::out_of_range);
+
+        auto moved = std::move(pointers);
+        EXPECT_TRUE(pointers.empty());
+        EXPECT_EQ(shared.use_count(), 1001u);
+    }
+    EXPECT_EQ(shared.use_count(), 1u);
+
+    // Types that are not trivially relocatable are moved one by one
+    usu::relocating_vector<std::string> names;
+    for (int i = 0; i < 100; i++)
+    {
+        names.push_back(std::string(40, static_cast<char>('a' + i % 26)));
+    }
+    EXPECT_EQ(names[27], std::string(40, 'b'));
+}
+
 // ------------------------
 // usu::unique_ptr tests
 // ------------------------
@@ -263,3 +1589,356 @@ TEST(Operators, Inequality)
     EXPECT_TRUE(p1 != p2);
     EXPECT_TRUE(p3 != p4);
 }
+
+// Counts calls so tests can see which deleter ran
+static int closedHandles = 0;
+void closeHandle(int* handle)
+{
+    closedHandles++;
+    delete handle;
+}
+
+TEST(Deleters, FunctionPointer)
+{
+    closedHandles = 0;
+    {
+        usu::unique_ptr<int, void (*)(int*)> handle(new int(3), closeHandle);
+        EXPECT_EQ(sizeof(handle), 2 * sizeof(int*));
+        auto moved = std::move(handle);
+        EXPECT_EQ(moved.get_deleter(), &closeHandle);
+    }
+    EXPECT_EQ(closedHandles, 1);
+
+    // Files are closed when the owner goes away
+    usu::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::tmpfile(), std::fclose);
+    EXPECT_NE(file.get(), nullptr);
+}
+
+TEST(Deleters, StatelessTakesNoSpace)
+{
+    closedHandles = 0;
+    using lambda_delete = decltype([](int* handle)
+                                   { closeHandle(handle); });
+    static_assert(sizeof(usu::unique_ptr<int, lambda_delete>) == sizeof(int*));
+    static_assert(sizeof(usu::unique_ptr<int[], lambda_delete>) == sizeof(int*));
+    {
+        usu::unique_ptr<int, lambda_delete> first(new int(1));
+        usu::unique_ptr<int, lambda_delete> second(new int(2));
+        first = std::move(second);
+        EXPECT_EQ(closedHandles, 1);
+        first.reset();
+    }
+    EXPECT_EQ(closedHandles, 2);
+}
+
+TEST(Instrumentation, DisabledByDefault)
+{
+    EXPECT_FALSE(usu::instrumentation::enabled);
+    auto counted = usu::make_shared<int>(1);
+    EXPECT_TRUE(usu::instrumentation::snapshot().empty());
+    // The lifetime stamp takes no space in the control block
+    EXPECT_EQ(sizeof(usu::detail::lifetime_stamp), 1u);
+}
+
+TEST(Sampling, RecordsLiveObjectsBySite)
+{
+    usu::sampling::set_interval(1);
+    usu::unique_ptr<std::string> unique;
+    std::uint_least32_t sharedLine = 0;
+    std::uint_least32_t uniqueLine = 0;
+    {
+        sharedLine = __LINE__ + 1;
+        auto shared = usu::make_shared_at<std::array<char, 1000>>(std::source_location::current());
+        auto copy = shared;
+        uniqueLine = __LINE__ + 1;
+        unique = usu::make_unique_at<std::string>(std::source_location::current(), 100, 'x');
+        usu::sampling::set_interval(0);
+        auto unsampled = usu::make_shared<int>(1);
+
+        auto sites = usu::sampling::top_sites();
+        ASSERT_EQ(sites.size(), 2u);
+        EXPECT_EQ(sites[0].site.line(), sharedLine);
+        EXPECT_EQ(sites[0].samples, 1u);
+        EXPECT_EQ(sites[0].maxUseCount, 2u);
+        EXPECT_GE(sites[0].sampledBytes, 1000u);
+        EXPECT_EQ(sites[0].estimatedBytes, sites[0].sampledBytes);
+        EXPECT_EQ(sites[1].site.line(), uniqueLine);
+        EXPECT_EQ(sites[1].maxUseCount, 1u);
+
+        std::ostringstream out;
+        usu::sampling::dump(out);
+        EXPECT_NE(out.str().find("TestMemory.cpp:" + std::to_string(sharedLine)), std::string::npos);
+    }
+    // The shared object died with its last owner; a released object leaves too
+    EXPECT_EQ(usu::sampling::live_samples().size(), 1u);
+    delete unique.release();
+    EXPECT_TRUE(usu::sampling::live_samples().empty());
+}
+
+// Remembers which constructor built it, and the location it was given
+struct Where
+{
+    Where() = default;
+    Where(std::source_location location) :
+        line(location.line())
+    {
+    }
+    Where(int number, std::source_location location) :
+        number(number), line(location.line())
+    {
+    }
+
+    int number = 0;
+    std::uint_least32_t line = 0;
+};
+
+TEST(Sampling, SiteIsNeverAConstructorArgument)
+{
+    usu::sampling::set_interval(1);
+    auto here = std::source_location::current();
+    auto shared = usu::make_shared<Where>(here);
+    auto unique = usu::make_unique<Where>(7, here);
+    auto other = usu::make_shared<std::array<char, 4000>>();
+    usu::sampling::set_interval(0);
+    EXPECT_EQ(shared->line, here.line());
+    EXPECT_EQ(unique->number, 7);
+    EXPECT_EQ(unique->line, here.line());
+
+    // The plain makers file their samples under an unknown site, by type
+    auto sites = usu::sampling::top_sites();
+    ASSERT_EQ(sites.size(), 2u);
+    EXPECT_EQ(sites[0].site.line(), 0u);
+    EXPECT_NE(sites[0].type.find("array"), std::string::npos);
+    EXPECT_EQ(sites[0].samples, 1u);
+    EXPECT_EQ(sites[1].site.line(), 0u);
+    EXPECT_NE(sites[1].type.find("Where"), std::string::npos);
+    EXPECT_EQ(sites[1].samples, 2u);
+
+    std::ostringstream out;
+    usu::sampling::dump(out);
+    EXPECT_NE(out.str().find("Where"), std::string::npos);
+}
+
+TEST(Sampling, EstimatesFromOneInN)
+{
+    constexpr std::size_t OBJECTS = 100'000;
+    usu::sampling::set_interval(100);
+    std::vector<usu::shared_ptr<std::uint64_t>> owners;
+    for (std::size_t i = 0; i < OBJECTS; i++)
+    {
+        owners.push_back(usu::make_shared<std::uint64_t>(i));
+    }
+    usu::sampling::set_interval(0);
+
+    auto sites = usu::sampling::top_sites();
+    ASSERT_EQ(sites.size(), 1u);
+    EXPECT_GT(sites[0].samples, 700u);
+    EXPECT_LT(sites[0].samples, 1300u);
+    EXPECT_EQ(sites[0].estimatedBytes, sites[0].sampledBytes * 100);
+    owners.clear();
+    EXPECT_TRUE(usu::sampling::live_samples().empty());
+}
+
+TEST(Sampling, CountdownFollowsTheInterval)
+{
+    // A thread's first allocation is counted like any other, not always sampled
+    usu::sampling::set_interval(1'000'000);
+    std::vector<usu::shared_ptr<int>> owners;
+    for (int t = 0; t < 16; t++)
+    {
+        std::thread([&]
+                    {
+                        for (int i = 0; i < 10; i++)
+                        {
+                            owners.push_back(usu::make_shared<int>(i));
+                        }
+                    })
+            .join();
+    }
+    EXPECT_TRUE(usu::sampling::live_samples().empty());
+
+    // A shorter interval takes effect at once rather than after the old gap
+    for (int i = 0; i < 10; i++)
+    {
+        owners.push_back(usu::make_shared<int>(i));
+    }
+    usu::sampling::set_interval(10);
+    for (int i = 0; i < 200; i++)
+    {
+        owners.push_back(usu::make_shared<int>(i));
+    }
+    usu::sampling::set_interval(0);
+    EXPECT_GT(usu::sampling::live_samples().size(), 5u);
+    owners.clear();
+    EXPECT_TRUE(usu::sampling::live_samples().empty());
+}
+
+TEST(CowPtr, SharesUntilWritten)
+{
+    auto original = usu::make_cow<std::vector<int>>(4, 7);
+    auto copy = original;
+    EXPECT_EQ(original.get(), copy.get());
+    EXPECT_EQ(original.use_count(), 2u);
+    EXPECT_FALSE(copy.unique());
+
+    // The first write separates the writer from the value it shared
+    copy.write()[0] = 1;
+    EXPECT_NE(original.get(), copy.get());
+    EXPECT_EQ((*original)[0], 7);
+    EXPECT_EQ((*copy)[0], 1);
+    EXPECT_TRUE(original.unique());
+
+    // A sole owner writes in place
+    const std::vector<int>* before = copy.get();
+    copy.write().push_back(2);
+    EXPECT_EQ(copy.get(), before);
+    EXPECT_EQ(copy->size(), 5u);
+
+    usu::cow_ptr<int> empty;
+    EXPECT_FALSE(empty);
+    EXPECT_THROW(empty.write(), std::runtime_error);
+}
+
+TEST(CowPtr, WritersOnSeveralThreads)
+{
+    auto shared = usu::make_cow<std::vector<int>>(64, 0);
+    std::vector<std::thread> workers;
+    std::atomic<int> mismatches = 0;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.emplace_back([shared, t, &mismatches]() mutable
+                             {
+                                 for (int i = 0; i < 1000; i++)
+                                 {
+                                     auto reader = shared;
+                                     shared.write()[i % 64] = t;
+                                     if ((*reader)[i % 64] != (i < 64 ? 0 : t))
+                                     {
+                                         mismatches++;
+                                     }
+                                 }
+                             });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_EQ(std::count(shared->begin(), shared->end(), 0), 64);
+}
+
+struct CompactNode
+{
+    Tracked payload;
+    usu::compact_shared_ptr<CompactNode> next;
+};
+
+TEST(CompactPtr, CountsInTheArena)
+{
+    static_assert(sizeof(usu::compact_shared_ptr<CompactNode>) == 4);
+    auto& arena = usu::compact_arena<CompactNode>::global();
+    {
+        auto first = usu::make_compact_shared<CompactNode>();
+        auto second = first;
+        EXPECT_EQ(first.use_count(), 2u);
+        EXPECT_EQ(first.get(), second.get());
+        EXPECT_EQ(arena.live(), 1u);
+
+        // A node can own the next one, and assigning from it releases the head
+        first->next = usu::make_compact_shared<CompactNode>();
+        second.reset();
+        first = first->next;
+        EXPECT_EQ(first.use_count(), 1u);
+        EXPECT_EQ(Tracked::live.load(), 1);
+        EXPECT_EQ(arena.live(), 1u);
+    }
+    EXPECT_EQ(Tracked::live.load(), 0);
+    EXPECT_EQ(arena.live(), 0u);
+
+    usu::compact_shared_ptr<CompactNode> empty;
+    EXPECT_EQ(empty.get(), nullptr);
+    EXPECT_THROW(*empty, std::runtime_error);
+}
+
+TEST(CompactPtr, UniqueOwnerAndSlotReuse)
+{
+    auto& arena = usu::compact_arena<std::string>::global();
+    auto unique = usu::make_compact_unique<std::string>("first");
+    std::uint32_t slot = unique.index();
+    EXPECT_EQ(*unique, "first");
+    unique.reset();
+    EXPECT_EQ(arena.live(), 0u);
+
+    // The freed slot is handed to the next object
+    auto reused = usu::make_compact_unique<std::string>("second");
+    EXPECT_EQ(reused.index(), slot);
+
+    usu::compact_shared_ptr<std::string> shared(std::move(reused));
+    EXPECT_FALSE(reused);
+    EXPECT_EQ(shared.use_count(), 1u);
+    EXPECT_EQ(*shared, "second");
+    shared.reset();
+    EXPECT_EQ(arena.live(), 0u);
+}
+
+TEST(CompactPtr, SharedAcrossThreads)
+{
+    auto shared = usu::make_compact_shared<int>(7);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.emplace_back([shared]
+                             {
+                                 for (int i = 0; i < 10000; i++)
+                                 {
+                                     usu::compact_shared_ptr<int> copy = shared;
+                                     auto own = usu::make_compact_shared<int>(*copy);
+                                 }
+                             });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    EXPECT_EQ(shared.use_count(), 1u);
+    EXPECT_EQ(usu::compact_arena<int>::global().live(), 1u);
+}
+
+TEST(CompactPtr, SlotsFreedOnOtherThreadsAreReused)
+{
+    constexpr std::size_t OBJECTS = usu::compact_arena<long>::SEGMENT_SLOTS + 1000;
+    auto& arena = usu::compact_arena<long>::global();
+    std::size_t reserved = 0;
+    for (int round = 0; round < 3; round++)
+    {
+        // One thread makes the objects and another drops them, and both exit
+        std::vector<usu::compact_unique_ptr<long>> objects;
+        std::thread([&]
+                    {
+                        for (std::size_t i = 0; i < OBJECTS; i++)
+                        {
+                            objects.push_back(usu::make_compact_unique<long>(static_cast<long>(i)));
+                        }
+                    })
+            .join();
+        std::vector<std::uint32_t> slots;
+        for (auto& object : objects)
+        {
+            slots.push_back(object.index());
+        }
+        std::sort(slots.begin(), slots.end());
+        EXPECT_EQ(std::adjacent_find(slots.begin(), slots.end()), slots.end());
+        EXPECT_EQ(arena.live(), OBJECTS);
+        std::thread([&]
+                    { objects.clear(); })
+            .join();
+        EXPECT_EQ(arena.live(), 0u);
+
+        // Later rounds fit in the slots the threads handed back
+        if (round == 0)
+        {
+            reserved = arena.reserved_bytes();
+        }
+        EXPECT_EQ(arena.reserved_bytes(), reserved);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cassert>
+#include <stdexcept>
+
+// ------------------------------------------------------------------
+//
+// Policies for the null and bounds checks on element access. checked
+// throws, as the pointers always have. assert_access only checks in
+// builds without NDEBUG. unchecked_access checks nothing, so indexing
+// compiles down to the raw load and loops can vectorize.
+//
+// operator[] and operator* use default_access, which is checked unless
+// the build defines USU_ASSERT_ACCESS or USU_UNCHECKED_ACCESS. Define
+// the same one in every translation unit. Hot loops can also pick a
+// policy per call with element<Access>(index).
+//
+// ------------------------------------------------------------------
+namespace usu
+{
+    struct checked_access
+    {
+        template <typename Exception>
+        static void require(bool condition, const char* message)
+        {
+            if (!condition)
+            {
+                throw Exception(message);
+            }
+        }
+    };
+
+    struct assert_access
+    {
+        template <typename Exception>
+        static void require([[maybe_unused]] bool condition, [[maybe_unused]] const char* message)
+        {
+            assert(condition && message);
+        }
+    };
+
+    struct unchecked_access
+    {
+        template <typename Exception>
+        static void require(bool, const char*)
+        {
+        }
+    };
+
+#if defined(USU_UNCHECKED_ACCESS)
+    using default_access = unchecked_access;
+#elif defined(USU_ASSERT_ACCESS)
+    using default_access = assert_access;
+#else
+    using default_access = checked_access;
+#endif
+} // namespace usu
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <type_traits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// ------------------------------------------------------------------
+//
+// Allocation layer used by the smart pointers. Small requests (control
+// blocks and small make_shared payloads) come from per-thread slab
+// pools; anything large or over-aligned goes to global operator new.
+//
+// Slabs are never given back to the operating system. A pool only
+// hands freed blocks to later allocations, so memory stays resident at
+// the high-water mark of the small objects that were live at once, even
+// after a thread that churned through them goes idle or exits.
+//
+// ------------------------------------------------------------------
+namespace usu
+{
+    namespace detail
+    {
+        constexpr std::size_t POOL_GRANULE = 16;
+        constexpr std::size_t POOL_MAX_SIZE = 256;
+        constexpr std::size_t POOL_CLASSES = POOL_MAX_SIZE / POOL_GRANULE;
+        constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+        class slab_cache;
+
+        struct free_node
+        {
+            free_node* next;
+        };
+
+        // Header at the start of every slab. Slabs are aligned to SLAB_SIZE, so a
+        // block finds its header (and the cache that owns it) by masking its address.
+        struct alignas(64) slab_header
+        {
+            slab_cache* owner;
+        };
+
+        // ------------------------------------------------------------------
+        //
+        // One thread's pool: a free list per size class, each class carved out
+        // of its own slabs. Blocks freed by the owning thread go straight back
+        // on its free list; blocks freed by other threads are pushed onto a
+        // lock-free per-class stack that the owner takes over in one exchange
+        // when its free list runs dry. When a thread exits its cache is parked
+        // and handed to the next new thread, so slabs are never orphaned.
+        //
+        // ------------------------------------------------------------------
+        class slab_cache
+        {
+          public:
+            // The calling thread's cache, adopting a parked one if available
+            static slab_cache& local();
+
+            void* allocate(std::size_t sizeClass);
+            // Returns a block from any thread to the cache that owns its slab
+            static void deallocate(void* ptr, std::size_t sizeClass);
+
+          private:
+            static slab_cache*& current();
+            static std::mutex& parkedMutex();
+            static slab_cache*& parkedHead();
+
+            void refill(std::size_t sizeClass);
+            void park();
+
+            free_node* freeLists[POOL_CLASSES] = {};
+            std::atomic<free_node*> remoteFrees[POOL_CLASSES] = {};
+            slab_cache* nextParked = nullptr;
+        };
+
+        inline slab_cache*& slab_cache::current()
+        {
+            thread_local slab_cache* cache = nullptr;
+            return cache;
+        }
+
+        inline std::mutex& slab_cache::parkedMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        inline slab_cache*& slab_cache::parkedHead()
+        {
+            static slab_cache* head = nullptr;
+            return head;
+        }
+
+        inline slab_cache& slab_cache::local()
+        {
+            struct holder
+            {
+                holder()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(parkedMutex());
+                        cache = parkedHead();
+                        if (cache)
+                        {
+                            parkedHead() = cache->nextParked;
+                        }
+                    }
+                    if (!cache)
+                    {
+                        cache = new slab_cache();
+                    }
+                    current() = cache;
+                }
+                ~holder() { cache->park(); }
+                slab_cache* cache;
+            };
+            thread_local holder threadHolder;
+            return *threadHolder.cache;
+        }
+
+        inline void slab_cache::park()
+        {
+            // Frees made on this thread from now on take the remote path
+            current() = nullptr;
+            std::lock_guard<std::mutex> lock(parkedMutex());
+            nextParked = parkedHead();
+            parkedHead() = this;
+        }
+
+        inline void* slab_cache::allocate(std::size_t sizeClass)
+        {
+            if (!freeLists[sizeClass])
+            {
+                refill(sizeClass);
+            }
+            free_node* node = freeLists[sizeClass];
+            freeLists[sizeClass] = node->next;
+            return node;
+        }
+
+        inline void slab_cache::deallocate(void* ptr, std::size_t sizeClass)
+        {
+            auto header = reinterpret_cast<slab_header*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(SLAB_SIZE - 1));
+            slab_cache* owner = header->owner;
+            auto node = static_cast<free_node*>(ptr);
+            if (owner == current())
+            {
+                node->next = owner->freeLists[sizeClass];
+                owner->freeLists[sizeClass] = node;
+                return;
+            }
+            std::atomic<free_node*>& remote = owner->remoteFrees[sizeClass];
+            node->next = remote.load(std::memory_order_relaxed);
+            while (!remote.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        inline void slab_cache::refill(std::size_t sizeClass)
+        {
+            // Reclaim what other threads have freed before carving a new slab
+            freeLists[sizeClass] = remoteFrees[sizeClass].exchange(nullptr, std::memory_order_acquire);
+            if (freeLists[sizeClass])
+            {
+                return;
+            }
+
+            void* memory = ::operator new(SLAB_SIZE, std::align_val_t(SLAB_SIZE));
+            auto header = ::new (memory) slab_header{ this };
+            std::size_t blockSize = (sizeClass + 1) * POOL_GRANULE;
+            auto first = reinterpret_cast<char*>(header) + sizeof(slab_header);
+            auto end = reinterpret_cast<char*>(memory) + SLAB_SIZE;
+            std::size_t blocks = static_cast<std::size_t>(end - first) / blockSize;
+            free_node* head = nullptr;
+            // Linked from the last block back, so the list hands them out in address order
+            for (std::size_t i = blocks; i > 0; i--)
+            {
+                head = ::new (first + (i - 1) * blockSize) free_node{ head };
+            }
+            freeLists[sizeClass] = head;
+        }
+
+        inline bool pool_eligible(std::size_t size, std::size_t alignment)
+        {
+            return size != 0 && size <= POOL_MAX_SIZE && alignment <= POOL_GRANULE;
+        }
+
+        inline void* pool_allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+        {
+            if (!pool_eligible(size, alignment))
+            {
+                return ::operator new(size, std::align_val_t(alignment));
+            }
+            return slab_cache::local().allocate((size - 1) / POOL_GRANULE);
+        }
+
+        inline void pool_deallocate(void* ptr, std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+        {
+            if (!pool_eligible(size, alignment))
+            {
+                ::operator delete(ptr, std::align_val_t(alignment));
+                return;
+            }
+            slab_cache::deallocate(ptr, (size - 1) / POOL_GRANULE);
+        }
+
+        // True when a factory's first argument names where to allocate rather than
+        // being a constructor argument, which selects the resource overloads
+        template <typename... Args>
+        constexpr bool leads_with_resource = false;
+
+        template <typename First, typename... Rest>
+        constexpr bool leads_with_resource<First, Rest...> =
+            std::is_convertible_v<std::decay_t<First>, std::pmr::memory_resource*> ||
+            std::is_base_of_v<std::pmr::memory_resource, std::remove_cvref_t<First>>;
+
+        // Allocates and constructs a Block with Alloc rebound to the block type
+        template <typename Block, typename Alloc, typename... Args>
+        Block* allocate_block(const Alloc& alloc, Args&&... args)
+        {
+            using block_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+            block_alloc blockAlloc(alloc);
+            Block* memory = std::allocator_traits<block_alloc>::allocate(blockAlloc, 1);
+            try
+            {
+                return ::new (static_cast<void*>(memory)) Block(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                std::allocator_traits<block_alloc>::deallocate(blockAlloc, memory, 1);
+                throw;
+            }
+        }
+
+        // Alignment for an array of T: the requested power of two, but never less than alignof(T)
+        template <typename T>
+        std::size_t array_alignment(std::size_t requested)
+        {
+            if (requested == 0 || (requested & (requested - 1)) != 0)
+            {
+                throw std::runtime_error("Array alignment must be a power of two.");
+            }
+            return std::max(requested, alignof(T));
+        }
+
+        // Bytes for count elements of T placed offset bytes into an allocation
+        template <typename T>
+        std::size_t array_bytes(std::size_t count, std::size_t offset = 0)
+        {
+            if (count > (SIZE_MAX - offset) / sizeof(T))
+            {
+                throw std::bad_array_new_length();
+            }
+            return offset + count * sizeof(T);
+        }
+
+        // Builds count elements in raw storage. for_overwrite default-initializes,
+        // which leaves trivial types untouched instead of zeroing them. If a
+        // constructor throws, the elements already built are destroyed.
+        template <typename T, bool Overwrite>
+        void construct_elements(T* first, std::size_t count)
+        {
+            if constexpr (Overwrite)
+            {
+                std::uninitialized_default_construct_n(first, count);
+            }
+            else
+            {
+                std::uninitialized_value_construct_n(first, count);
+            }
+        }
+
+        // Destroys in reverse order of construction, as delete[] does
+        template <typename T>
+        void destroy_elements(T* first, std::size_t count) noexcept
+        {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                for (std::size_t i = count; i > 0; i--)
+                {
+                    first[i - 1].~T();
+                }
+            }
+        }
+    } // namespace detail
+
+    // Standard allocator interface over the per-thread slab pools
+    template <typename T>
+    class pool_allocator
+    {
+      public:
+        using value_type = T;
+
+        pool_allocator() = default;
+        template <typename U>
+        pool_allocator(const pool_allocator<U>&) noexcept
+        {
+        }
+
+        T* allocate(std::size_t n) { return static_cast<T*>(detail::pool_allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T* ptr, std::size_t n) noexcept { detail::pool_deallocate(ptr, n * sizeof(T), alignof(T)); }
+
+        template <typename U>
+        bool operator==(const pool_allocator<U>&) const noexcept { return true; }
+    };
+
+    // Deleter for unique_ptr that destroys and frees through an allocator
+    template <typename Alloc>
+    class allocator_delete
+    {
+      public:
+        using traits = std::allocator_traits<Alloc>;
+        using value_type = typename traits::value_type;
+
+        allocator_delete() = default;
+        explicit allocator_delete(const Alloc& alloc) :
+            alloc(alloc)
+        {
+        }
+
+        void operator()(value_type* ptr)
+        {
+            traits::destroy(alloc, ptr);
+            traits::deallocate(alloc, ptr, 1);
+        }
+
+      private:
+        [[no_unique_address]] Alloc alloc;
+    };
+} // namespace usu
@@ -0,0 +1,258 @@
+#pragma once
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace usu
+{
+    // What happens to arena objects when their owners let go
+    enum class arena_teardown
+    {
+        // The last owner runs the destructor; the memory waits for reset()
+        with_owner,
+        // Owners do nothing; reset() runs the destructors, newest first, and types
+        // that are trivially destructible are never tracked at all
+        at_reset
+    };
+
+    // ------------------------------------------------------------------
+    //
+    // Monotonic arena for request-scoped object graphs. Allocation bumps a
+    // pointer through chunks taken from an upstream resource, deallocation
+    // is free, and reset() hands everything back at once while keeping the
+    // newest chunk for the next request. An arena is used from one thread.
+    //
+    // Pass the arena itself to make_shared/make_unique for its teardown
+    // mode to apply; through a memory_resource* it always behaves as
+    // with_owner. No pointer into the arena may be used after reset().
+    //
+    // ------------------------------------------------------------------
+    class arena : public std::pmr::memory_resource
+    {
+      public:
+        explicit arena(arena_teardown teardown = arena_teardown::with_owner, std::size_t chunkSize = 64 * 1024,
+                       std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        // Destructor
+        ~arena() override;
+
+        arena_teardown teardown() const { return mode; }
+
+        void reset();
+
+        // Runs the object's destructor at the next reset()
+        template <typename T>
+        void destroy_on_reset(T* object);
+
+      protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+      private:
+        struct chunk
+        {
+            chunk* next;
+            std::size_t size;
+        };
+
+        struct cleanup
+        {
+            void (*destroy)(void*);
+            void* object;
+            cleanup* next;
+        };
+
+        void* grow(std::size_t bytes, std::size_t alignment);
+        void runCleanups();
+        void releaseChunks(chunk* keep);
+
+        arena_teardown mode;
+        std::pmr::memory_resource* upstream;
+        std::size_t nextChunkSize;
+        chunk* chunks;
+        char* cursor;
+        char* end;
+        cleanup* cleanups;
+    };
+
+    inline arena::arena(arena_teardown teardown, std::size_t chunkSize, std::pmr::memory_resource* upstream) :
+        mode(teardown), upstream(upstream), nextChunkSize(chunkSize), chunks(nullptr), cursor(nullptr), end(nullptr), cleanups(nullptr)
+    {
+    }
+
+    // Destructor
+    inline arena::~arena()
+    {
+        runCleanups();
+        releaseChunks(nullptr);
+    }
+
+    inline void arena::reset()
+    {
+        runCleanups();
+        releaseChunks(chunks);
+        if (chunks)
+        {
+            cursor = reinterpret_cast<char*>(chunks + 1);
+            end = reinterpret_cast<char*>(chunks) + chunks->size;
+        }
+    }
+
+    template <typename T>
+    void arena::destroy_on_reset(T* object)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            void* memory = allocate(sizeof(cleanup), alignof(cleanup));
+            cleanups = ::new (memory) cleanup{ [](void* ptr)
+                                               { static_cast<T*>(ptr)->~T(); },
+                                               object, cleanups };
+        }
+    }
+
+    inline void* arena::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(cursor);
+        auto aligned = (address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+        if (cursor && aligned + bytes <= reinterpret_cast<std::uintptr_t>(end))
+        {
+            cursor = reinterpret_cast<char*>(aligned + bytes);
+            return reinterpret_cast<void*>(aligned);
+        }
+        return grow(bytes, alignment);
+    }
+
+    // Starts a new chunk big enough for the request; chunks double in size as the arena grows
+    inline void* arena::grow(std::size_t bytes, std::size_t alignment)
+    {
+        std::size_t needed = sizeof(chunk) + bytes + alignment;
+        std::size_t size = (nextChunkSize > needed) ? nextChunkSize : needed;
+        auto newChunk = ::new (upstream->allocate(size, alignof(std::max_align_t))) chunk{ chunks, size };
+        chunks = newChunk;
+        nextChunkSize = size * 2;
+        cursor = reinterpret_cast<char*>(newChunk + 1);
+        end = reinterpret_cast<char*>(newChunk) + size;
+        return do_allocate(bytes, alignment);
+    }
+
+    inline void arena::runCleanups()
+    {
+        // Newest first, so objects go before anything they were built from
+        for (cleanup* entry = cleanups; entry; entry = entry->next)
+        {
+            entry->destroy(entry->object);
+        }
+        cleanups = nullptr;
+    }
+
+    // Frees every chunk except keep, which is the newest and so the largest
+    inline void arena::releaseChunks(chunk* keep)
+    {
+        chunk* current = chunks;
+        while (current)
+        {
+            chunk* next = current->next;
+            if (current != keep)
+            {
+                upstream->deallocate(current, current->size, alignof(std::max_align_t));
+            }
+            current = next;
+        }
+        chunks = keep;
+        if (keep)
+        {
+            keep->next = nullptr;
+        }
+        else
+        {
+            cursor = nullptr;
+            end = nullptr;
+        }
+    }
+
+    // Allocator that draws from an arena and follows its teardown mode
+    template <typename T>
+    class arena_allocator
+    {
+      public:
+        using value_type = T;
+
+        arena_allocator() = default;
+        explicit arena_allocator(arena& owner) :
+            owner(&owner)
+        {
+        }
+        template <typename U>
+        arena_allocator(const arena_allocator<U>& other) noexcept :
+            owner(other.owner)
+        {
+        }
+
+        T* allocate(std::size_t n) { return static_cast<T*>(owner->allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T*, std::size_t) noexcept {}
+
+        template <typename U, typename... Args>
+        void construct(U* ptr, Args&&... args)
+        {
+            ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+            if (owner->teardown() == arena_teardown::at_reset)
+            {
+                // Registering allocates; if that fails the caller treats the object
+                // as never built, so it must not outlive this call
+                try
+                {
+                    owner->destroy_on_reset(ptr);
+                }
+                catch (...)
+                {
+                    ptr->~U();
+                    throw;
+                }
+            }
+        }
+
+        template <typename U>
+        void destroy(U* ptr)
+        {
+            if (owner->teardown() == arena_teardown::with_owner)
+            {
+                ptr->~U();
+            }
+        }
+
+        template <typename U>
+        bool operator==(const arena_allocator<U>& other) const noexcept { return owner == other.owner; }
+
+      private:
+        template <typename U>
+        friend class arena_allocator;
+
+        arena* owner = nullptr;
+    };
+
+    // Deleter of the unique_ptr that make_unique returns for an arena
+    template <typename T>
+    using arena_delete = allocator_delete<arena_allocator<T>>;
+
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+    shared_ptr<T, Counter> make_shared(arena& objectArena, Args&&... args)
+    {
+        return allocate_shared<T, Counter>(arena_allocator<T>(objectArena), std::forward<Args>(args)...);
+    }
+
+    template <typename T, typename... Args>
+    unique_ptr<T, arena_delete<T>> make_unique(arena& objectArena, Args&&... args)
+    {
+        return allocate_unique<T>(arena_allocator<T>(objectArena), std::forward<Args>(args)...);
+    }
+} // namespace usu
@@ -0,0 +1,215 @@
+#pragma once
+#include "shared_ptr.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace usu
+{
+    // ------------------------------------------------------------------
+    //
+    // A shared_ptr that can be loaded and replaced from many threads at once
+    // without a lock. The current value lives in an immutable node, and the
+    // node's address shares one 64-bit word with a count of readers that are
+    // in the middle of copying it (split reference counting):
+    //
+    //  - load() bumps the reader count in the word, copies the node's value and
+    //    then takes its count back out of the word.
+    //  - A writer swaps in a new node and hands the reader count it swapped
+    //    out over to the old node. Readers that find the word changed settle
+    //    with the old node instead; whoever settles last deletes it.
+    //
+    // Readers never wait on a writer. Node addresses are assumed to fit in 48
+    // bits (true for user space on x86-64 and AArch64), and at most 65535
+    // loads may be in flight on one atomic_shared_ptr at a time.
+    //
+    // ------------------------------------------------------------------
+    template <typename T>
+    class atomic_shared_ptr
+    {
+      public:
+        static constexpr bool is_always_lock_free = std::atomic<std::uint64_t>::is_always_lock_free;
+
+        atomic_shared_ptr();
+        explicit atomic_shared_ptr(shared_ptr<T> desired);
+        atomic_shared_ptr(const atomic_shared_ptr<T>&) = delete;
+        atomic_shared_ptr<T>& operator=(const atomic_shared_ptr<T>&) = delete;
+
+        // Destructor
+        ~atomic_shared_ptr();
+
+        shared_ptr<T> load() const;
+        void store(shared_ptr<T> desired);
+        shared_ptr<T> exchange(shared_ptr<T> desired);
+
+        // Replaces the value only if it still owns the same object as expected.
+        // On failure expected is updated to the current value. The weak form
+        // gives up if another writer gets in first, instead of retrying.
+        bool compare_exchange_weak(shared_ptr<T>& expected, shared_ptr<T> desired);
+        bool compare_exchange_strong(shared_ptr<T>& expected, shared_ptr<T> desired);
+
+        bool is_lock_free() const { return word.is_lock_free(); }
+
+      private:
+        // Holds one published value. released counts readers that have settled
+        // with the node after it was swapped out, minus the count the writer
+        // handed over; the node is deleted when the two balance out.
+        struct node
+        {
+            explicit node(shared_ptr<T>&& desired) :
+                value(std::move(desired))
+            {
+            }
+
+            void settle(std::int64_t delta)
+            {
+                if (released.fetch_add(delta, std::memory_order_acq_rel) + delta == 0)
+                {
+                    delete this;
+                }
+            }
+
+            std::atomic<std::int64_t> released{ 0 };
+            shared_ptr<T> value;
+        };
+
+        static constexpr unsigned int COUNT_SHIFT = 48;
+        static constexpr std::uint64_t ONE_READER = std::uint64_t(1) << COUNT_SHIFT;
+        static constexpr std::uint64_t NODE_MASK = ONE_READER - 1;
+
+        static node* nodeOf(std::uint64_t packed) { return reinterpret_cast<node*>(packed & NODE_MASK); }
+        static std::int64_t readersOf(std::uint64_t packed) { return static_cast<std::int64_t>(packed >> COUNT_SHIFT); }
+        static std::uint64_t pack(node* n) { return reinterpret_cast<std::uintptr_t>(n); }
+
+        // Registers as a reader of the current node, which keeps it alive until leave()
+        std::uint64_t enter() const { return word.fetch_add(ONE_READER, std::memory_order_acquire) + ONE_READER; }
+        void leave(node* n) const;
+        // Settles the node that was swapped out of the word, which held packed
+        void retire(std::uint64_t packed, std::int64_t ownReaders);
+        bool compareExchange(shared_ptr<T>& expected, shared_ptr<T>&& desired, bool retry);
+
+        static bool equivalent(shared_ptr<T>& lhs, shared_ptr<T>& rhs) { return lhs.get() == rhs.get() && lhs.block == rhs.block; }
+
+        mutable std::atomic<std::uint64_t> word;
+    };
+
+    static_assert(sizeof(void*) == 8, "atomic_shared_ptr packs a reader count into the upper bits of a 64-bit pointer");
+
+    template <typename T>
+    atomic_shared_ptr<T>::atomic_shared_ptr() :
+        word(pack(new node(shared_ptr<T>())))
+    {
+    }
+
+    template <typename T>
+    atomic_shared_ptr<T>::atomic_shared_ptr(shared_ptr<T> desired) :
+        word(pack(new node(std::move(desired))))
+    {
+    }
+
+    // Destructor
+    template <typename T>
+    atomic_shared_ptr<T>::~atomic_shared_ptr()
+    {
+        retire(word.load(std::memory_order_acquire), 0);
+    }
+
+    template <typename T>
+    shared_ptr<T> atomic_shared_ptr<T>::load() const
+    {
+        node* current = nodeOf(enter());
+        shared_ptr<T> result(current->value);
+        leave(current);
+        return result;
+    }
+
+    template <typename T>
+    void atomic_shared_ptr<T>::store(shared_ptr<T> desired)
+    {
+        exchange(std::move(desired));
+    }
+
+    template <typename T>
+    shared_ptr<T> atomic_shared_ptr<T>::exchange(shared_ptr<T> desired)
+    {
+        std::uint64_t previous = word.exchange(pack(new node(std::move(desired))), std::memory_order_acq_rel);
+        // Readers may still be copying the old value, so copy rather than move it out
+        shared_ptr<T> result(nodeOf(previous)->value);
+        retire(previous, 0);
+        return result;
+    }
+
+    template <typename T>
+    bool atomic_shared_ptr<T>::compare_exchange_weak(shared_ptr<T>& expected, shared_ptr<T> desired)
+    {
+        return compareExchange(expected, std::move(desired), false);
+    }
+
+    template <typename T>
+    bool atomic_shared_ptr<T>::compare_exchange_strong(shared_ptr<T>& expected, shared_ptr<T> desired)
+    {
+        return compareExchange(expected, std::move(desired), true);
+    }
+
+    template <typename T>
+    void atomic_shared_ptr<T>::leave(node* n) const
+    {
+        std::uint64_t current = word.load(std::memory_order_relaxed);
+        while (nodeOf(current) == n)
+        {
+            if (word.compare_exchange_weak(current, current - ONE_READER, std::memory_order_release, std::memory_order_relaxed))
+            {
+                return;
+            }
+        }
+        // A writer swapped the node out and handed our count over to it
+        n->settle(-1);
+    }
+
+    template <typename T>
+    void atomic_shared_ptr<T>::retire(std::uint64_t packed, std::int64_t ownReaders)
+    {
+        nodeOf(packed)->settle(readersOf(packed) - ownReaders);
+    }
+
+    template <typename T>
+    bool atomic_shared_ptr<T>::compareExchange(shared_ptr<T>& expected, shared_ptr<T>&& desired, bool retry)
+    {
+        node* replacement = nullptr;
+        while (true)
+        {
+            std::uint64_t current = enter();
+            node* n = nodeOf(current);
+            if (!equivalent(n->value, expected))
+            {
+                expected = n->value;
+                leave(n);
+                delete replacement;
+                return false;
+            }
+
+            if (!replacement)
+            {
+                replacement = new node(std::move(desired));
+            }
+            // Our own reader count goes out with the node, so it is not handed over
+            while (nodeOf(current) == n)
+            {
+                if (word.compare_exchange_weak(current, pack(replacement), std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    retire(current, 1);
+                    return true;
+                }
+            }
+            n->settle(-1);
+
+            if (!retry)
+            {
+                expected = load();
+                delete replacement;
+                return false;
+            }
+        }
+    }
+} // namespace usu
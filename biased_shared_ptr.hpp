@@ -0,0 +1,422 @@
+#pragma once
+#include "thread_index.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace usu
+{
+    namespace detail
+    {
+        class biased_owner;
+
+        // ------------------------------------------------------------------
+        //
+        // Biased reference count. The thread that created the object updates
+        // localCount with plain increments; every other thread uses the atomic
+        // shared count. The live count is always localCount + shared count, so
+        // the shared count may go negative when handles copied on the owner
+        // thread die elsewhere.
+        //
+        // When localCount drops to zero the owner merges: it marks the shared
+        // count MERGED and from then on every thread uses the shared count
+        // alone. If the shared count goes negative before that, a foreign
+        // thread queues the block with its owner (which holds one reference
+        // while it is queued) so the owner merges it at its next operation,
+        // or, if the owner thread has exited, the foreign thread merges it.
+        //
+        // ------------------------------------------------------------------
+        class biased_block_base
+        {
+          public:
+            // Takes no reference on owner; the derived block does once its object is built
+            explicit biased_block_base(biased_owner* owner);
+
+            void acquire();
+            void release();
+            // Exact on the owner thread, a snapshot elsewhere
+            unsigned int use_count() const;
+
+            // Folds the owner's count into the shared count and drops the queue's
+            // reference. Runs on the owner thread, or after the owner has exited.
+            void merge();
+
+          protected:
+            virtual ~biased_block_base() = default;
+
+          private:
+            static constexpr long long MERGED = 1;
+            static constexpr long long QUEUED = 2;
+            static constexpr long long ONE = 4;
+
+            static long long countOf(long long value) { return value >> 2; }
+
+            bool onOwnerThread() const { return ownerIndex == thread_index() && localCount > 0; }
+            void mergeLocal();
+            void releaseShared();
+            void destroy();
+
+            biased_owner* owner;
+            unsigned int ownerIndex;
+            unsigned int localCount;
+            // ONE * count + QUEUED + MERGED
+            std::atomic<long long> shared;
+        };
+
+        // Per-thread queue of blocks waiting for their owner to merge them. It
+        // outlives its thread until every block it owns has been destroyed.
+        class biased_owner
+        {
+          public:
+            // The calling thread's owner record, created on first use
+            static biased_owner* current();
+
+            void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+            void release()
+            {
+                if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete this;
+                }
+            }
+
+            // Called from a foreign thread when a block needs merging
+            void enqueue(biased_block_base* block);
+
+            // Merges everything queued for this thread; cheap when nothing is queued
+            void drain()
+            {
+                if (hasPending.load(std::memory_order_acquire))
+                {
+                    drainQueue();
+                }
+            }
+
+            // The owning thread is exiting: merge what is queued and let later
+            // requests be merged by the threads that make them
+            void retire();
+
+          private:
+            void drainQueue();
+
+            std::mutex mutex;
+            std::vector<biased_block_base*> queue;
+            std::atomic<bool> hasPending{ false };
+            bool alive = true;
+            std::atomic<unsigned int> refs{ 1 };
+        };
+
+        inline biased_block_base::biased_block_base(biased_owner* owner) :
+            owner(owner), ownerIndex(thread_index()), localCount(1), shared(0)
+        {
+        }
+
+        inline void biased_block_base::acquire()
+        {
+            if (onOwnerThread())
+            {
+                localCount++;
+            }
+            else
+            {
+                shared.fetch_add(ONE, std::memory_order_relaxed);
+            }
+        }
+
+        inline void biased_block_base::release()
+        {
+            // Merge anything queued first; that may fold this block's local count too
+            bool isOwner = (ownerIndex == thread_index());
+            if (isOwner)
+            {
+                owner->drain();
+            }
+            if (isOwner && localCount > 0)
+            {
+                if (--localCount == 0)
+                {
+                    mergeLocal();
+                }
+            }
+            else
+            {
+                releaseShared();
+            }
+        }
+
+        inline unsigned int biased_block_base::use_count() const
+        {
+            long long value = shared.load(std::memory_order_relaxed);
+            long long count = countOf(value) - ((value & QUEUED) ? 1 : 0);
+            if (ownerIndex == thread_index())
+            {
+                count += localCount;
+            }
+            return (count > 0) ? static_cast<unsigned int>(count) : 0;
+        }
+
+        inline void biased_block_base::merge()
+        {
+            if (localCount > 0)
+            {
+                mergeLocal();
+            }
+            releaseShared();
+        }
+
+        inline void biased_block_base::mergeLocal()
+        {
+            long long added = ONE * localCount + MERGED;
+            localCount = 0;
+            if (countOf(shared.fetch_add(added, std::memory_order_acq_rel) + added) == 0)
+            {
+                destroy();
+            }
+        }
+
+        inline void biased_block_base::releaseShared()
+        {
+            long long value = shared.fetch_sub(ONE, std::memory_order_acq_rel) - ONE;
+            if (value & MERGED)
+            {
+                if (countOf(value) == 0)
+                {
+                    destroy();
+                }
+                return;
+            }
+            if (countOf(value) < 0)
+            {
+                // The owner still counts handles that have died here; ask it to merge
+                while (!(value & (MERGED | QUEUED)))
+                {
+                    if (shared.compare_exchange_weak(value, value + ONE + QUEUED, std::memory_order_acq_rel, std::memory_order_relaxed))
+                    {
+                        owner->enqueue(this);
+                        return;
+                    }
+                }
+            }
+        }
+
+        inline void biased_block_base::destroy()
+        {
+            biased_owner* ownerRecord = owner;
+            delete this;
+            ownerRecord->release();
+        }
+
+        inline biased_owner* biased_owner::current()
+        {
+            struct slot
+            {
+                ~slot() { owner->retire(); }
+                biased_owner* owner = new biased_owner();
+            };
+            thread_local slot threadSlot;
+            return threadSlot.owner;
+        }
+
+        inline void biased_owner::enqueue(biased_block_base* block)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (alive)
+                {
+                    queue.push_back(block);
+                    hasPending.store(true, std::memory_order_release);
+                    return;
+                }
+            }
+            block->merge();
+        }
+
+        inline void biased_owner::drainQueue()
+        {
+            std::vector<biased_block_base*> pending;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.swap(queue);
+                hasPending.store(false, std::memory_order_relaxed);
+            }
+            for (auto block : pending)
+            {
+                block->merge();
+            }
+        }
+
+        inline void biased_owner::retire()
+        {
+            std::vector<biased_block_base*> pending;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                alive = false;
+                pending.swap(queue);
+            }
+            for (auto block : pending)
+            {
+                block->merge();
+            }
+            release();
+        }
+
+        template <typename T>
+        class biased_block : public biased_block_base
+        {
+          public:
+            template <typename... Args>
+            explicit biased_block(biased_owner* owner, Args&&... args) :
+                biased_block_base(owner), object(std::forward<Args>(args)...)
+            {
+                // Only now, so a throwing constructor leaves the owner untouched
+                owner->retain();
+            }
+
+            T* get() { return &object; }
+
+          private:
+            T object;
+        };
+    } // namespace detail
+
+    // ------------------------------------------------------------------
+    //
+    // Shared pointer for objects that are mostly copied on the thread that
+    // made them. Copies and destruction on that thread cost a plain
+    // increment or decrement; other threads fall back to an atomic count,
+    // and the two are merged once the owner has let go of all its handles.
+    // Handles may be moved to, copied on and destroyed by any thread.
+    //
+    // ------------------------------------------------------------------
+    template <typename T>
+    class biased_shared_ptr
+    {
+      public:
+        biased_shared_ptr();
+        biased_shared_ptr(const biased_shared_ptr<T>& otherShared);
+        biased_shared_ptr(biased_shared_ptr<T>&& otherShared) noexcept;
+
+        // Destructor
+        ~biased_shared_ptr();
+
+        biased_shared_ptr<T>& operator=(const biased_shared_ptr<T>& otherShared);
+        biased_shared_ptr<T>& operator=(biased_shared_ptr<T>&& otherShared) noexcept;
+
+        T* get() const { return (block) ? block->get() : nullptr; }
+        T* operator->() const { return get(); }
+        T& operator*() const;
+
+        // Exact on the thread that created the object, a snapshot elsewhere
+        unsigned int use_count() const { return (block) ? block->use_count() : 0; }
+
+      private:
+        template <typename U, typename... Args>
+        friend biased_shared_ptr<U> make_biased_shared(Args&&... args);
+
+        // Adopts a block that already holds one reference
+        explicit biased_shared_ptr(detail::biased_block<T>* adoptBlock);
+
+        void release();
+
+        detail::biased_block<T>* block;
+    };
+
+    template <typename T>
+    biased_shared_ptr<T>::biased_shared_ptr() :
+        block(nullptr)
+    {
+    }
+
+    template <typename T>
+    biased_shared_ptr<T>::biased_shared_ptr(detail::biased_block<T>* adoptBlock) :
+        block(adoptBlock)
+    {
+    }
+
+    // Copy constructor
+    template <typename T>
+    biased_shared_ptr<T>::biased_shared_ptr(const biased_shared_ptr<T>& otherShared) :
+        block(otherShared.block)
+    {
+        if (block)
+        {
+            block->acquire();
+        }
+    }
+
+    // Move constructor
+    template <typename T>
+    biased_shared_ptr<T>::biased_shared_ptr(biased_shared_ptr<T>&& otherShared) noexcept :
+        block(otherShared.block)
+    {
+        otherShared.block = nullptr;
+    }
+
+    // Destructor
+    template <typename T>
+    biased_shared_ptr<T>::~biased_shared_ptr()
+    {
+        release();
+    }
+
+    // Copy assignment operator
+    template <typename T>
+    biased_shared_ptr<T>& biased_shared_ptr<T>::operator=(const biased_shared_ptr<T>& otherShared)
+    {
+        if (this != &otherShared)
+        {
+            if (otherShared.block)
+            {
+                otherShared.block->acquire();
+            }
+            release();
+            block = otherShared.block;
+        }
+        return *this;
+    }
+
+    // Move assignment operator
+    template <typename T>
+    biased_shared_ptr<T>& biased_shared_ptr<T>::operator=(biased_shared_ptr<T>&& otherShared) noexcept
+    {
+        if (this != &otherShared)
+        {
+            release();
+            block = otherShared.block;
+            otherShared.block = nullptr;
+        }
+        return *this;
+    }
+
+    template <typename T>
+    T& biased_shared_ptr<T>::operator*() const
+    {
+        if (!block)
+        {
+            throw std::runtime_error("Attempting to dereference a null biased_shared_ptr.");
+        }
+        return *block->get();
+    }
+
+    template <typename T>
+    void biased_shared_ptr<T>::release()
+    {
+        if (block)
+        {
+            block->release();
+        }
+        block = nullptr;
+    }
+
+    // The calling thread becomes the object's owner
+    template <typename T, typename... Args>
+    biased_shared_ptr<T> make_biased_shared(Args&&... args)
+    {
+        auto owner = detail::biased_owner::current();
+        owner->drain();
+        return biased_shared_ptr<T>(new detail::biased_block<T>(owner, std::forward<Args>(args)...));
+    }
+} // namespace usu
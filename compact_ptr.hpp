@@ -0,0 +1,557 @@
+#pragma once
+#include "access_policy.hpp"
+#include "ref_counter.hpp"
+#include "relocation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// ------------------------------------------------------------------
+//
+// Four-byte owning handles for large object graphs. Every object of a
+// type lives in that type's compact_arena, and a handle holds only the
+// 32-bit index of its slot. The reference counts sit in an array beside
+// the objects rather than in front of them, so walking the graph never
+// touches a count.
+//
+// Each (T, Counter) pair has one arena for the whole process. Its
+// slots sit in fixed segments that never move, and a released slot is
+// handed to the next object made. Index 0 is the null handle, so up to
+// 2^32 - 1 objects can be live at once. The memory of an arena is kept
+// until the process exits.
+//
+// Every thread keeps its own cache of free slots, so creating and
+// releasing objects takes no lock. A thread's cache is filled from the
+// arena, and emptied back into it, SLOT_BATCH slots at a time, and is
+// handed back whole when the thread exits.
+//
+// ------------------------------------------------------------------
+namespace usu
+{
+    template <typename T, typename Counter = thread_safe_counter>
+    class compact_arena
+    {
+      public:
+        static constexpr unsigned int SEGMENT_BITS = 16;
+        static constexpr std::size_t SEGMENT_SLOTS = std::size_t{ 1 } << SEGMENT_BITS;
+        static constexpr std::size_t SEGMENTS = (std::size_t{ 1 } << 32) / SEGMENT_SLOTS;
+        // Slots a thread takes from, or gives back to, the arena at a time
+        static constexpr std::size_t SLOT_BATCH = 64;
+
+        compact_arena(const compact_arena&) = delete;
+        compact_arena& operator=(const compact_arena&) = delete;
+
+        // The arena for T. It is never destroyed, so handles held by static
+        // objects stay valid until the very end.
+        static compact_arena& global();
+
+        // Builds a T in a free slot with a count of 1 and returns its index
+        template <typename... Args>
+        std::uint32_t create(Args&&... args);
+
+        T* get(std::uint32_t index) const;
+        unsigned int use_count(std::uint32_t index) const { return Counter::load(count(index)); }
+        void increment(std::uint32_t index) { Counter::increment(count(index)); }
+        // Drops a reference; the last one destroys the object and frees the slot
+        void release(std::uint32_t index);
+        // Destroys the object regardless of its count, for unique owners
+        void destroy(std::uint32_t index);
+
+        std::size_t live() const { return liveObjects.load(std::memory_order_relaxed); }
+        // Memory held by the arena, including slots that are not in use
+        std::size_t reserved_bytes() const;
+
+      private:
+        struct segment
+        {
+            alignas(T) unsigned char objects[SEGMENT_SLOTS * sizeof(T)];
+            typename Counter::type counts[SEGMENT_SLOTS];
+        };
+
+        using slot_cache = std::vector<std::uint32_t>;
+
+        compact_arena();
+
+        // The calling thread's free slots, or null once the thread has handed
+        // them back at exit
+        static slot_cache* localCache();
+
+        segment& segmentOf(std::uint32_t index) const;
+        typename Counter::type& count(std::uint32_t index) const { return segmentOf(index).counts[index & (SEGMENT_SLOTS - 1)]; }
+        std::uint32_t takeSlot();
+        void freeSlot(std::uint32_t index);
+        // Moves up to wanted free slots into slots, making new ones if the
+        // arena has none
+        void refill(slot_cache& slots, std::size_t wanted);
+        // Moves the count slots freed longest ago from slots back to the arena
+        void spill(slot_cache& slots, std::size_t count);
+
+        std::atomic<std::size_t> liveObjects;
+        mutable std::mutex mutex;
+        // Slots released and not held by any thread's cache
+        std::vector<std::uint32_t> freeSlots;
+        // Every slot below this has been handed out at least once
+        std::uint64_t nextSlot;
+        std::size_t segmentCount;
+        // Inline rather than behind a pointer, so finding an object takes one
+        // dependent load less
+        std::atomic<segment*> segments[SEGMENTS];
+    };
+
+    template <typename T, typename Counter>
+    compact_arena<T, Counter>::compact_arena() :
+        liveObjects(0), nextSlot(1), segmentCount(0), segments()
+    {
+    }
+
+    template <typename T, typename Counter>
+    compact_arena<T, Counter>& compact_arena<T, Counter>::global()
+    {
+        static auto* arena = new compact_arena();
+        return *arena;
+    }
+
+    template <typename T, typename Counter>
+    template <typename... Args>
+    std::uint32_t compact_arena<T, Counter>::create(Args&&... args)
+    {
+        std::uint32_t index = takeSlot();
+        auto& slots = segmentOf(index);
+        std::size_t offset = index & (SEGMENT_SLOTS - 1);
+        try
+        {
+            ::new (static_cast<void*>(slots.objects + offset * sizeof(T))) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            freeSlot(index);
+            throw;
+        }
+        slots.counts[offset] = 1;
+        liveObjects.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    template <typename T, typename Counter>
+    T* compact_arena<T, Counter>::get(std::uint32_t index) const
+    {
+        if (index == 0)
+        {
+            return nullptr;
+        }
+        auto& slots = segmentOf(index);
+        return std::launder(reinterpret_cast<T*>(slots.objects + (index & (SEGMENT_SLOTS - 1)) * sizeof(T)));
+    }
+
+    template <typename T, typename Counter>
+    void compact_arena<T, Counter>::release(std::uint32_t index)
+    {
+        if (Counter::decrement(count(index)))
+        {
+            destroy(index);
+        }
+    }
+
+    template <typename T, typename Counter>
+    void compact_arena<T, Counter>::destroy(std::uint32_t index)
+    {
+        get(index)->~T();
+        liveObjects.fetch_sub(1, std::memory_order_relaxed);
+        freeSlot(index);
+    }
+
+    template <typename T, typename Counter>
+    std::size_t compact_arena<T, Counter>::reserved_bytes() const
+    {
+        std::lock_guard lock(mutex);
+        return sizeof(compact_arena) + segmentCount * sizeof(segment);
+    }
+
+    // Anyone holding an index got it, one way or another, from the thread that
+    // created the object, and so after its segment was published; a relaxed
+    // load is enough to see it
+    template <typename T, typename Counter>
+    typename compact_arena<T, Counter>::segment& compact_arena<T, Counter>::segmentOf(std::uint32_t index) const
+    {
+        return *segments[index >> SEGMENT_BITS].load(std::memory_order_relaxed);
+    }
+
+    template <typename T, typename Counter>
+    typename compact_arena<T, Counter>::slot_cache* compact_arena<T, Counter>::localCache()
+    {
+        // Set as the thread exits, after which its releases go straight to the arena
+        thread_local bool handedBack = false;
+        struct holder
+        {
+            holder() { cache.reserve(2 * SLOT_BATCH); }
+            ~holder()
+            {
+                handedBack = true;
+                global().spill(cache, cache.size());
+            }
+            slot_cache cache;
+        };
+
+        if (handedBack)
+        {
+            return nullptr;
+        }
+        thread_local holder threadHolder;
+        return &threadHolder.cache;
+    }
+
+    template <typename T, typename Counter>
+    std::uint32_t compact_arena<T, Counter>::takeSlot()
+    {
+        slot_cache* cache = localCache();
+        if (!cache)
+        {
+            slot_cache single;
+            refill(single, 1);
+            return single.back();
+        }
+        if (cache->empty())
+        {
+            refill(*cache, SLOT_BATCH);
+        }
+        std::uint32_t index = cache->back();
+        cache->pop_back();
+        return index;
+    }
+
+    template <typename T, typename Counter>
+    void compact_arena<T, Counter>::freeSlot(std::uint32_t index)
+    {
+        slot_cache* cache = localCache();
+        if (!cache)
+        {
+            std::lock_guard lock(mutex);
+            freeSlots.push_back(index);
+            return;
+        }
+        // The cache never holds more than it reserved, so this never allocates
+        if (cache->size() == 2 * SLOT_BATCH)
+        {
+            spill(*cache, SLOT_BATCH);
+        }
+        cache->push_back(index);
+    }
+
+    template <typename T, typename Counter>
+    void compact_arena<T, Counter>::refill(slot_cache& slots, std::size_t wanted)
+    {
+        std::lock_guard lock(mutex);
+        if (!freeSlots.empty())
+        {
+            std::size_t taken = std::min(wanted, freeSlots.size());
+            slots.insert(slots.end(), freeSlots.end() - static_cast<std::ptrdiff_t>(taken), freeSlots.end());
+            freeSlots.resize(freeSlots.size() - taken);
+            return;
+        }
+        if (nextSlot > UINT32_MAX)
+        {
+            throw std::runtime_error("compact_arena has no free slots left.");
+        }
+        std::uint64_t last = std::min<std::uint64_t>(nextSlot + wanted - 1, UINT32_MAX);
+        for (std::uint64_t index = nextSlot; index <= last; index++)
+        {
+            auto& segmentSlots = segments[index >> SEGMENT_BITS];
+            if (!segmentSlots.load(std::memory_order_relaxed))
+            {
+                segmentSlots.store(new segment, std::memory_order_release);
+                segmentCount++;
+            }
+        }
+        // Taken from the back, so the lowest index is handed out first
+        for (std::uint64_t index = last; index >= nextSlot; index--)
+        {
+            slots.push_back(static_cast<std::uint32_t>(index));
+        }
+        nextSlot = last + 1;
+    }
+
+    template <typename T, typename Counter>
+    void compact_arena<T, Counter>::spill(slot_cache& slots, std::size_t count)
+    {
+        std::lock_guard lock(mutex);
+        freeSlots.insert(freeSlots.end(), slots.begin(), slots.begin() + static_cast<std::ptrdiff_t>(count));
+        slots.erase(slots.begin(), slots.begin() + static_cast<std::ptrdiff_t>(count));
+    }
+
+    template <typename T, typename Counter>
+    class compact_unique_ptr;
+
+    // Shared owner of an object in compact_arena<T, Counter>, four bytes wide
+    template <typename T, typename Counter = thread_safe_counter>
+    class compact_shared_ptr
+    {
+      public:
+        compact_shared_ptr() noexcept;
+        compact_shared_ptr(const compact_shared_ptr<T, Counter>& otherShared) noexcept;
+        compact_shared_ptr(compact_shared_ptr<T, Counter>&& otherShared) noexcept;
+        // Takes over the object of a unique owner, whose count is already 1
+        compact_shared_ptr(compact_unique_ptr<T, Counter>&& otherUnique) noexcept;
+
+        // Destructor
+        ~compact_shared_ptr();
+
+        compact_shared_ptr<T, Counter>& operator=(const compact_shared_ptr<T, Counter>& otherShared) noexcept;
+        compact_shared_ptr<T, Counter>& operator=(compact_shared_ptr<T, Counter>&& otherShared) noexcept;
+
+        T* get() const { return compact_arena<T, Counter>::global().get(slot); }
+        T* operator->() const { return get(); }
+        T& operator*() const;
+        // Returns the reference count
+        unsigned int use_count() const { return slot ? compact_arena<T, Counter>::global().use_count(slot) : 0; }
+        // The object's slot in the arena, 0 when null
+        std::uint32_t index() const { return slot; }
+        void reset();
+
+        explicit operator bool() const { return slot != 0; }
+        bool operator==(const compact_shared_ptr<T, Counter>& otherShared) const { return slot == otherShared.slot; }
+        bool operator!=(const compact_shared_ptr<T, Counter>& otherShared) const { return slot != otherShared.slot; }
+
+      private:
+        template <typename U, typename C, typename... Args>
+        friend compact_shared_ptr<U, C> make_compact_shared(Args&&... args);
+
+        // Adopts a slot that already holds one reference
+        explicit compact_shared_ptr(std::uint32_t adoptSlot) noexcept;
+
+        std::uint32_t slot;
+    };
+
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>::compact_shared_ptr() noexcept :
+        slot(0)
+    {
+    }
+
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>::compact_shared_ptr(std::uint32_t adoptSlot) noexcept :
+        slot(adoptSlot)
+    {
+    }
+
+    // Copy constructor
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>::compact_shared_ptr(const compact_shared_ptr<T, Counter>& otherShared) noexcept :
+        slot(otherShared.slot)
+    {
+        if (slot)
+        {
+            compact_arena<T, Counter>::global().increment(slot);
+        }
+    }
+
+    // Move constructor
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>::compact_shared_ptr(compact_shared_ptr<T, Counter>&& otherShared) noexcept :
+        slot(otherShared.slot)
+    {
+        otherShared.slot = 0;
+    }
+
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>::compact_shared_ptr(compact_unique_ptr<T, Counter>&& otherUnique) noexcept :
+        slot(otherUnique.slot)
+    {
+        otherUnique.slot = 0;
+    }
+
+    // Destructor
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>::~compact_shared_ptr()
+    {
+        reset();
+    }
+
+    // Copy assignment operator. The new reference is taken before the old one is
+    // dropped, in case otherShared lives inside the object being released.
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>& compact_shared_ptr<T, Counter>::operator=(const compact_shared_ptr<T, Counter>& otherShared) noexcept
+    {
+        if (this != &otherShared)
+        {
+            std::uint32_t oldSlot = slot;
+            slot = otherShared.slot;
+            if (slot)
+            {
+                compact_arena<T, Counter>::global().increment(slot);
+            }
+            if (oldSlot)
+            {
+                compact_arena<T, Counter>::global().release(oldSlot);
+            }
+        }
+        return *this;
+    }
+
+    // Move assignment operator
+    template <typename T, typename Counter>
+    compact_shared_ptr<T, Counter>& compact_shared_ptr<T, Counter>::operator=(compact_shared_ptr<T, Counter>&& otherShared) noexcept
+    {
+        if (this != &otherShared)
+        {
+            std::uint32_t oldSlot = slot;
+            slot = otherShared.slot;
+            otherShared.slot = 0;
+            // Released last, in case otherShared lived inside the old object
+            if (oldSlot)
+            {
+                compact_arena<T, Counter>::global().release(oldSlot);
+            }
+        }
+        return *this;
+    }
+
+    template <typename T, typename Counter>
+    T& compact_shared_ptr<T, Counter>::operator*() const
+    {
+        default_access::require<std::runtime_error>(slot != 0, "Attempting to dereference a null compact_shared_ptr.");
+        return *get();
+    }
+
+    template <typename T, typename Counter>
+    void compact_shared_ptr<T, Counter>::reset()
+    {
+        if (slot)
+        {
+            std::uint32_t oldSlot = slot;
+            slot = 0;
+            compact_arena<T, Counter>::global().release(oldSlot);
+        }
+    }
+
+    // Sole owner of an object in compact_arena<T, Counter>, four bytes wide
+    template <typename T, typename Counter = thread_safe_counter>
+    class compact_unique_ptr
+    {
+      public:
+        compact_unique_ptr() noexcept;
+        compact_unique_ptr(const compact_unique_ptr<T, Counter>&) = delete;
+        compact_unique_ptr(compact_unique_ptr<T, Counter>&& otherUnique) noexcept;
+
+        // Destructor
+        ~compact_unique_ptr();
+
+        compact_unique_ptr<T, Counter>& operator=(const compact_unique_ptr<T, Counter>&) = delete;
+        compact_unique_ptr<T, Counter>& operator=(compact_unique_ptr<T, Counter>&& otherUnique) noexcept;
+
+        T* get() const { return compact_arena<T, Counter>::global().get(slot); }
+        T* operator->() const { return get(); }
+        T& operator*() const;
+        // The object's slot in the arena, 0 when null
+        std::uint32_t index() const { return slot; }
+        void reset();
+
+        explicit operator bool() const { return slot != 0; }
+        bool operator==(const compact_unique_ptr<T, Counter>& otherUnique) const { return slot == otherUnique.slot; }
+        bool operator!=(const compact_unique_ptr<T, Counter>& otherUnique) const { return slot != otherUnique.slot; }
+
+      private:
+        friend class compact_shared_ptr<T, Counter>;
+        template <typename U, typename C, typename... Args>
+        friend compact_unique_ptr<U, C> make_compact_unique(Args&&... args);
+
+        explicit compact_unique_ptr(std::uint32_t adoptSlot) noexcept;
+
+        std::uint32_t slot;
+    };
+
+    template <typename T, typename Counter>
+    compact_unique_ptr<T, Counter>::compact_unique_ptr() noexcept :
+        slot(0)
+    {
+    }
+
+    template <typename T, typename Counter>
+    compact_unique_ptr<T, Counter>::compact_unique_ptr(std::uint32_t adoptSlot) noexcept :
+        slot(adoptSlot)
+    {
+    }
+
+    // Move constructor
+    template <typename T, typename Counter>
+    compact_unique_ptr<T, Counter>::compact_unique_ptr(compact_unique_ptr<T, Counter>&& otherUnique) noexcept :
+        slot(otherUnique.slot)
+    {
+        otherUnique.slot = 0;
+    }
+
+    // Destructor
+    template <typename T, typename Counter>
+    compact_unique_ptr<T, Counter>::~compact_unique_ptr()
+    {
+        reset();
+    }
+
+    // Move assignment operator
+    template <typename T, typename Counter>
+    compact_unique_ptr<T, Counter>& compact_unique_ptr<T, Counter>::operator=(compact_unique_ptr<T, Counter>&& otherUnique) noexcept
+    {
+        if (this != &otherUnique)
+        {
+            std::uint32_t oldSlot = slot;
+            slot = otherUnique.slot;
+            otherUnique.slot = 0;
+            if (oldSlot)
+            {
+                compact_arena<T, Counter>::global().destroy(oldSlot);
+            }
+        }
+        return *this;
+    }
+
+    template <typename T, typename Counter>
+    T& compact_unique_ptr<T, Counter>::operator*() const
+    {
+        default_access::require<std::runtime_error>(slot != 0, "Attempting to dereference a null compact_unique_ptr.");
+        return *get();
+    }
+
+    template <typename T, typename Counter>
+    void compact_unique_ptr<T, Counter>::reset()
+    {
+        if (slot)
+        {
+            std::uint32_t oldSlot = slot;
+            slot = 0;
+            compact_arena<T, Counter>::global().destroy(oldSlot);
+        }
+    }
+
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+    compact_shared_ptr<T, Counter> make_compact_shared(Args&&... args)
+    {
+        return compact_shared_ptr<T, Counter>(compact_arena<T, Counter>::global().create(std::forward<Args>(args)...));
+    }
+
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+    compact_unique_ptr<T, Counter> make_compact_unique(Args&&... args)
+    {
+        return compact_unique_ptr<T, Counter>(compact_arena<T, Counter>::global().create(std::forward<Args>(args)...));
+    }
+
+    // A handle is just an index, so containers may move them with memcpy
+    template <typename T, typename Counter>
+    struct is_trivially_relocatable<compact_shared_ptr<T, Counter>> : std::true_type
+    {
+    };
+
+    template <typename T, typename Counter>
+    struct is_trivially_relocatable<compact_unique_ptr<T, Counter>> : std::true_type
+    {
+    };
+
+    static_assert(sizeof(compact_shared_ptr<int>) == 4, "compact_shared_ptr must be four bytes wide");
+    static_assert(sizeof(compact_unique_ptr<int>) == 4, "compact_unique_ptr must be four bytes wide");
+} // namespace usu
@@ -0,0 +1,90 @@
+#pragma once
+#include "access_policy.hpp"
+#include "ref_counter.hpp"
+#include "relocation.hpp"
+#include "shared_ptr.hpp"
+
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace usu
+{
+    // ------------------------------------------------------------------
+    //
+    // Copy-on-write value handle. Copies share one T through a shared_ptr
+    // control block, and reads go through const accessors. write() hands
+    // back a mutable T, first giving this handle its own copy if any
+    // other handle still shares the current one.
+    //
+    // The sole-owner check is an acquire load of the strong count. Only
+    // this handle can add owners to its own value, so once the count
+    // reads 1 it stays 1 while write() runs, and every other owner's
+    // reads happened before it released.
+    //
+    // ------------------------------------------------------------------
+    template <typename T, typename Counter = thread_safe_counter>
+    class cow_ptr
+    {
+      public:
+        static_assert(!std::is_array_v<T>, "cow_ptr holds a single value");
+
+        cow_ptr() = default;
+        // Shares the value already owned by owner. Other shared_ptr owners of it
+        // count as sharers, so write() copies while they exist; weak_ptrs to it
+        // must not be locked while a write() may be running.
+        explicit cow_ptr(shared_ptr<T, Counter> owner) noexcept;
+
+        const T* get() const { return shared.get(); }
+        const T* operator->() const { return shared.get(); }
+        const T& operator*() const;
+
+        // The value, copied first if another handle shares it
+        T& write();
+
+        // Returns the number of handles sharing the value
+        unsigned int use_count() const { return shared.use_count(); }
+        bool unique() const { return shared.block && shared.block->unique(); }
+
+        explicit operator bool() const { return shared.get() != nullptr; }
+
+      private:
+        shared_ptr<T, Counter> shared;
+    };
+
+    template <typename T, typename Counter>
+    cow_ptr<T, Counter>::cow_ptr(shared_ptr<T, Counter> owner) noexcept :
+        shared(std::move(owner))
+    {
+    }
+
+    template <typename T, typename Counter>
+    const T& cow_ptr<T, Counter>::operator*() const
+    {
+        default_access::require<std::runtime_error>(shared.get() != nullptr, "Attempting to dereference a null cow_ptr.");
+        return *shared.get();
+    }
+
+    template <typename T, typename Counter>
+    T& cow_ptr<T, Counter>::write()
+    {
+        default_access::require<std::runtime_error>(shared.get() != nullptr, "Attempting to write through a null cow_ptr.");
+        if (!shared.block->unique())
+        {
+            const T& current = *shared.get();
+            shared = make_shared<T, Counter>(current);
+        }
+        return *shared.get();
+    }
+
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+    cow_ptr<T, Counter> make_cow(Args&&... args)
+    {
+        return cow_ptr<T, Counter>(make_shared<T, Counter>(std::forward<Args>(args)...));
+    }
+
+    template <typename T, typename Counter>
+    struct is_trivially_relocatable<cow_ptr<T, Counter>> : is_trivially_relocatable<shared_ptr<T, Counter>>
+    {
+    };
+} // namespace usu
@@ -0,0 +1,238 @@
+#pragma once
+#include "shared_ptr.hpp"
+#include "thread_record.hpp"
+#include "unique_ptr.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace usu
+{
+    namespace detail
+    {
+        // A node that has been unlinked but may still be read, tagged with the
+        // global epoch at the time it was retired
+        struct retired_node
+        {
+            void* object;
+            void (*destroy)(void*);
+            std::uint64_t epoch;
+        };
+
+        // One thread's view of a domain. Records are never freed while the
+        // domain lives; when a thread exits its record, retire list included,
+        // is handed to the next thread that needs one.
+        struct epoch_record
+        {
+            // (epoch << 1) | 1 while the thread is inside a guard, 0 otherwise
+            std::atomic<std::uint64_t> active{ 0 };
+            std::atomic<bool> inUse{ true };
+            unsigned int nesting = 0;
+            std::vector<retired_node> retired;
+            // Retire list length at which the next collection runs
+            std::size_t collectAt = 0;
+            epoch_record* next = nullptr;
+        };
+
+        // Shared state of an epoch_domain, owned by the domain. Threads find their
+        // record through local_record().
+        class epoch_state
+        {
+          public:
+            epoch_state() = default;
+            epoch_state(const epoch_state&) = delete;
+            epoch_state& operator=(const epoch_state&) = delete;
+
+            // Destructor, which frees everything still retired
+            ~epoch_state();
+
+            using record_type = epoch_record;
+            epoch_record* acquireRecord() { return acquire_record(records); }
+
+            // Moves the global epoch forward if every thread inside a guard has seen it
+            bool tryAdvance();
+            // Frees the record's nodes that no reader can still hold
+            void collect(epoch_record& record);
+
+            std::atomic<std::uint64_t> globalEpoch{ 2 };
+            std::atomic<epoch_record*> records{ nullptr };
+        };
+
+        inline epoch_state::~epoch_state()
+        {
+            epoch_record* record = records.load(std::memory_order_acquire);
+            while (record)
+            {
+                std::vector<retired_node> retired;
+                retired.swap(record->retired);
+                for (auto& node : retired)
+                {
+                    node.destroy(node.object);
+                }
+                epoch_record* next = record->next;
+                delete record;
+                record = next;
+            }
+        }
+
+        inline bool epoch_state::tryAdvance()
+        {
+            std::uint64_t epoch = globalEpoch.load(std::memory_order_acquire);
+            // Pairs with the fence in guard's constructor: either we see the reader
+            // or the reader sees every unlink made before this point
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (epoch_record* record = records.load(std::memory_order_acquire); record; record = record->next)
+            {
+                std::uint64_t active = record->active.load(std::memory_order_relaxed);
+                if ((active & 1) && (active >> 1) != epoch)
+                {
+                    return false;
+                }
+            }
+            return globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+        }
+
+        // A destructor run here may retire more nodes to this record, so the
+        // list is taken out of the record while it is walked
+        inline void epoch_state::collect(epoch_record& record)
+        {
+            std::uint64_t epoch = globalEpoch.load(std::memory_order_acquire);
+            std::vector<retired_node> pending;
+            pending.swap(record.retired);
+            std::size_t kept = 0;
+            for (auto& node : pending)
+            {
+                // Two advances since retirement mean every guard that could see it has ended
+                if (node.epoch + 2 <= epoch)
+                {
+                    node.destroy(node.object);
+                }
+                else
+                {
+                    pending[kept++] = node;
+                }
+            }
+            pending.resize(kept);
+            if (record.retired.empty())
+            {
+                record.retired.swap(pending);
+            }
+            else
+            {
+                record.retired.insert(record.retired.end(), pending.begin(), pending.end());
+            }
+        }
+    } // namespace detail
+
+    // ------------------------------------------------------------------
+    //
+    // Epoch-based reclamation for lock-free structures. Readers enter a
+    // guard before touching shared nodes; writers retire the nodes they
+    // unlink instead of deleting them. A retired node is freed once the
+    // global epoch has moved on twice, which can only happen after every
+    // guard that was open when it was retired has closed. Each thread
+    // keeps its own retire list and frees it in batches, trying to move
+    // the epoch forward each time a batch fills up.
+    //
+    // ------------------------------------------------------------------
+    class epoch_domain
+    {
+      public:
+        // Retired nodes per thread before it tries to advance the epoch and free
+        static constexpr std::size_t BATCH = 64;
+
+        // Keeps nodes read inside it from being freed; guards may nest
+        class guard
+        {
+          public:
+            explicit guard(epoch_domain& domain);
+            guard(const guard&) = delete;
+            guard& operator=(const guard&) = delete;
+
+            // Destructor
+            ~guard();
+
+          private:
+            detail::epoch_record* record;
+        };
+
+        epoch_domain();
+
+        // Takes ownership of an unlinked node and frees it once no guard can see it
+        template <typename T>
+        void retire(unique_ptr<T>&& node);
+        void retire(void* object, void (*destroy)(void*));
+
+        // Advances the epoch as far as readers allow and frees this thread's
+        // reclaimable nodes; returns how many are still waiting
+        std::size_t collect();
+
+      private:
+        detail::epoch_record& localRecord();
+
+        shared_ptr<detail::epoch_state> state;
+    };
+
+    inline epoch_domain::epoch_domain() :
+        state(make_shared<detail::epoch_state>())
+    {
+    }
+
+    inline detail::epoch_record& epoch_domain::localRecord()
+    {
+        return detail::local_record(state);
+    }
+
+    inline epoch_domain::guard::guard(epoch_domain& domain) :
+        record(&domain.localRecord())
+    {
+        if (record->nesting++ == 0)
+        {
+            std::uint64_t epoch = domain.state->globalEpoch.load(std::memory_order_relaxed);
+            record->active.store((epoch << 1) | 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    // Destructor
+    inline epoch_domain::guard::~guard()
+    {
+        if (--record->nesting == 0)
+        {
+            record->active.store(0, std::memory_order_release);
+        }
+    }
+
+    template <typename T>
+    void epoch_domain::retire(unique_ptr<T>&& node)
+    {
+        retire(node.release(), [](void* object)
+               { delete static_cast<T*>(object); });
+    }
+
+    inline void epoch_domain::retire(void* object, void (*destroy)(void*))
+    {
+        auto& record = localRecord();
+        record.retired.push_back({ object, destroy, state->globalEpoch.load(std::memory_order_acquire) });
+        if (record.retired.size() >= record.collectAt)
+        {
+            state->tryAdvance();
+            state->collect(record);
+            // While a slow reader holds the epoch back, wait for the list to double
+            // rather than rescanning it on every retire
+            record.collectAt = record.retired.size() * 2 + BATCH;
+        }
+    }
+
+    inline std::size_t epoch_domain::collect()
+    {
+        auto& record = localRecord();
+        state->tryAdvance();
+        state->tryAdvance();
+        state->collect(record);
+        return record.retired.size();
+    }
+} // namespace usu
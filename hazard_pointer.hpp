@@ -0,0 +1,244 @@
+#pragma once
+#include "shared_ptr.hpp"
+#include "thread_record.hpp"
+#include "unique_ptr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace usu
+{
+    namespace detail
+    {
+        // One thread's hazard slots and retire list in a domain
+        struct hazard_record
+        {
+            static constexpr unsigned int SLOTS = 4;
+
+            std::atomic<const void*> slots[SLOTS] = {};
+            // Bit i is set while slot i belongs to a live hazard_pointer
+            unsigned int slotsTaken = 0;
+            std::atomic<bool> inUse{ true };
+            std::vector<std::pair<void*, void (*)(void*)>> retired;
+            // Retire list length at which the next scan runs
+            std::size_t scanAt = 0;
+            hazard_record* next = nullptr;
+        };
+
+        // Shared state of a hazard_domain, owned by the domain
+        class hazard_state
+        {
+          public:
+            hazard_state() = default;
+            hazard_state(const hazard_state&) = delete;
+            hazard_state& operator=(const hazard_state&) = delete;
+
+            // Destructor, which frees everything still retired
+            ~hazard_state();
+
+            using record_type = hazard_record;
+            hazard_record* acquireRecord() { return acquire_record(records); }
+
+            // Frees the record's retired objects that no slot points at
+            void scan(hazard_record& record);
+
+            std::atomic<hazard_record*> records{ nullptr };
+        };
+
+        inline hazard_state::~hazard_state()
+        {
+            hazard_record* record = records.load(std::memory_order_acquire);
+            while (record)
+            {
+                std::vector<std::pair<void*, void (*)(void*)>> retired;
+                retired.swap(record->retired);
+                for (auto& [object, destroy] : retired)
+                {
+                    destroy(object);
+                }
+                hazard_record* next = record->next;
+                delete record;
+                record = next;
+            }
+        }
+
+        // A destructor run here may retire more objects to this record, so the
+        // list is taken out of the record while it is walked
+        inline void hazard_state::scan(hazard_record& record)
+        {
+            // Pairs with the fence in protect(): either we see the reader's slot, or
+            // the reader sees the unlink and retries
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::vector<const void*> hazards;
+            for (hazard_record* other = records.load(std::memory_order_acquire); other; other = other->next)
+            {
+                for (auto& slot : other->slots)
+                {
+                    if (const void* hazard = slot.load(std::memory_order_acquire))
+                    {
+                        hazards.push_back(hazard);
+                    }
+                }
+            }
+            std::sort(hazards.begin(), hazards.end());
+
+            std::vector<std::pair<void*, void (*)(void*)>> pending;
+            pending.swap(record.retired);
+            std::size_t kept = 0;
+            for (auto& entry : pending)
+            {
+                if (std::binary_search(hazards.begin(), hazards.end(), entry.first))
+                {
+                    pending[kept++] = entry;
+                }
+                else
+                {
+                    entry.second(entry.first);
+                }
+            }
+            pending.resize(kept);
+            if (record.retired.empty())
+            {
+                record.retired.swap(pending);
+            }
+            else
+            {
+                record.retired.insert(record.retired.end(), pending.begin(), pending.end());
+            }
+        }
+    } // namespace detail
+
+    // ------------------------------------------------------------------
+    //
+    // Hazard pointers: a reader publishes the address it is about to use
+    // in one of its thread's slots, and writers retire the objects they
+    // unlink instead of deleting them. Retired objects are freed in
+    // batches by scanning every published slot and skipping the ones still
+    // in use. Reads cost a store and a fence rather than two atomic updates
+    // to a shared count, and no count cache line bounces between readers.
+    //
+    // ------------------------------------------------------------------
+    class hazard_domain
+    {
+      public:
+        // Retired objects per thread before the first scan
+        static constexpr std::size_t BATCH = 64;
+
+        hazard_domain();
+
+        // Takes ownership of an unlinked object and frees it once no slot points at it
+        template <typename T>
+        void retire(unique_ptr<T>&& object);
+        void retire(void* object, void (*destroy)(void*));
+
+        // Frees this thread's retired objects that are no longer protected and
+        // returns how many are still waiting
+        std::size_t collect();
+
+      private:
+        friend class hazard_pointer;
+
+        detail::hazard_record& localRecord() { return detail::local_record(state); }
+
+        shared_ptr<detail::hazard_state> state;
+    };
+
+    // A claim on one of the calling thread's hazard slots. Each thread has
+    // hazard_record::SLOTS of them per domain.
+    class hazard_pointer
+    {
+      public:
+        explicit hazard_pointer(hazard_domain& domain);
+        hazard_pointer(const hazard_pointer&) = delete;
+        hazard_pointer& operator=(const hazard_pointer&) = delete;
+
+        // Destructor
+        ~hazard_pointer();
+
+        // Loads source and publishes it, retrying until the published value is
+        // still current. The object stays alive until reset() or destruction.
+        template <typename T>
+        T* protect(const std::atomic<T*>& source);
+
+        void reset() { slot->store(nullptr, std::memory_order_release); }
+
+      private:
+        detail::hazard_record* record;
+        unsigned int index;
+        std::atomic<const void*>* slot;
+    };
+
+    inline hazard_domain::hazard_domain() :
+        state(make_shared<detail::hazard_state>())
+    {
+    }
+
+    template <typename T>
+    void hazard_domain::retire(unique_ptr<T>&& object)
+    {
+        retire(object.release(), [](void* ptr)
+               { delete static_cast<T*>(ptr); });
+    }
+
+    inline void hazard_domain::retire(void* object, void (*destroy)(void*))
+    {
+        auto& record = localRecord();
+        record.retired.emplace_back(object, destroy);
+        if (record.retired.size() >= record.scanAt)
+        {
+            state->scan(record);
+            // Objects still protected stay; wait for as many new ones before rescanning
+            record.scanAt = record.retired.size() * 2 + BATCH;
+        }
+    }
+
+    inline std::size_t hazard_domain::collect()
+    {
+        auto& record = localRecord();
+        state->scan(record);
+        return record.retired.size();
+    }
+
+    inline hazard_pointer::hazard_pointer(hazard_domain& domain) :
+        record(&domain.localRecord()), index(0)
+    {
+        while (index < detail::hazard_record::SLOTS && (record->slotsTaken & (1u << index)))
+        {
+            index++;
+        }
+        if (index == detail::hazard_record::SLOTS)
+        {
+            throw std::runtime_error("All hazard pointer slots on this thread are in use.");
+        }
+        record->slotsTaken |= (1u << index);
+        slot = &record->slots[index];
+    }
+
+    // Destructor
+    inline hazard_pointer::~hazard_pointer()
+    {
+        reset();
+        record->slotsTaken &= ~(1u << index);
+    }
+
+    template <typename T>
+    T* hazard_pointer::protect(const std::atomic<T*>& source)
+    {
+        T* current = source.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot->store(current, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            T* confirmed = source.load(std::memory_order_acquire);
+            if (confirmed == current)
+            {
+                return current;
+            }
+            current = confirmed;
+        }
+    }
+} // namespace usu
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(USU_INSTRUMENTATION)
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+#if __has_include(<cxxabi.h>)
+#include <cstdlib>
+#include <cxxabi.h>
+#endif
+#endif
+
+// ------------------------------------------------------------------
+//
+// Per-type counters for the traffic through shared_ptr and unique_ptr:
+// objects taken into ownership, destroyed, copied and moved, how many
+// are live and the most that were live at once, plus a histogram of
+// how long shared objects lived. Build with USU_INSTRUMENTATION
+// defined, in every translation unit, to turn it on; otherwise every
+// hook is an empty inline function and the control block carries no
+// extra fields.
+//
+// Counters go to buffers owned by the calling thread, written without
+// atomic read-modify-writes; snapshot() sums them on demand. The live
+// and peak live counts are the exception: a peak across threads cannot
+// be rebuilt from per-thread totals, so both are atomics shared by every
+// thread, one pair per type. Copies and moves never touch them, but
+// each object taken into ownership, destroyed or released updates the
+// live count and may update the peak, and those updates contend when
+// several threads make or drop objects of the same type.
+//
+// ------------------------------------------------------------------
+namespace usu
+{
+    namespace instrumentation
+    {
+        // Bucket i counts lifetimes in [2^i, 2^(i+1)) nanoseconds; the first
+        // also counts 0 and the last everything longer
+        constexpr std::size_t LIFETIME_BUCKETS = 48;
+
+#if defined(USU_INSTRUMENTATION)
+        constexpr bool enabled = true;
+#else
+        constexpr bool enabled = false;
+#endif
+
+        // Totals for one type, summed over every thread. T[] is counted apart
+        // from T. Lifetimes are only known for objects owned by shared_ptr.
+        struct type_counters
+        {
+            std::string type;
+            std::uint64_t allocations = 0;
+            std::uint64_t destructions = 0;
+            std::uint64_t copies = 0;
+            std::uint64_t moves = 0;
+            std::int64_t live = 0;
+            std::int64_t peakLive = 0;
+            std::array<std::uint64_t, LIFETIME_BUCKETS> lifetimes{};
+        };
+    } // namespace instrumentation
+
+#if defined(USU_INSTRUMENTATION)
+    namespace detail
+    {
+        // A type seen by the hooks; index selects its counters in every buffer
+        struct instrument_type
+        {
+            std::size_t index = 0;
+            std::string name;
+            std::atomic<std::int64_t> live{ 0 };
+            std::atomic<std::int64_t> peakLive{ 0 };
+        };
+
+        struct instrument_counts
+        {
+            std::atomic<std::uint64_t> allocations{ 0 };
+            std::atomic<std::uint64_t> destructions{ 0 };
+            std::atomic<std::uint64_t> copies{ 0 };
+            std::atomic<std::uint64_t> moves{ 0 };
+            std::array<std::atomic<std::uint64_t>, instrumentation::LIFETIME_BUCKETS> lifetimes{};
+        };
+
+        // One thread's counters, by type index. Only the owning thread grows the
+        // vector, and it does so under the registry mutex that readers hold.
+        struct instrument_buffer
+        {
+            std::vector<std::unique_ptr<instrument_counts>> counts;
+        };
+
+        struct instrument_registry
+        {
+            std::mutex mutex;
+            std::deque<instrument_type> types;
+            std::vector<instrument_buffer*> buffers;
+            // Totals of threads that have exited
+            instrument_buffer retired;
+        };
+
+        // Never destroyed, so pointers released by static destructors are still counted
+        inline instrument_registry& instrument_state()
+        {
+            static auto* state = new instrument_registry();
+            return *state;
+        }
+
+        // Only the owning thread writes a counter, so a plain load and store will
+        // do; the atomics just let snapshot() read it while the thread runs
+        inline void bump(std::atomic<std::uint64_t>& counter)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        inline void grow(instrument_buffer& buffer, std::size_t types)
+        {
+            while (buffer.counts.size() < types)
+            {
+                buffer.counts.push_back(std::make_unique<instrument_counts>());
+            }
+        }
+
+        inline void fold(instrument_buffer& into, const instrument_buffer& from)
+        {
+            grow(into, from.counts.size());
+            for (std::size_t i = 0; i < from.counts.size(); i++)
+            {
+                auto& to = *into.counts[i];
+                const auto& counts = *from.counts[i];
+                to.allocations += counts.allocations.load(std::memory_order_relaxed);
+                to.destructions += counts.destructions.load(std::memory_order_relaxed);
+                to.copies += counts.copies.load(std::memory_order_relaxed);
+                to.moves += counts.moves.load(std::memory_order_relaxed);
+                for (std::size_t bucket = 0; bucket < counts.lifetimes.size(); bucket++)
+                {
+                    to.lifetimes[bucket] += counts.lifetimes[bucket].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Plain thread_local state, so it can still be read while the thread's
+        // other thread_locals are being destroyed
+        struct instrument_thread
+        {
+            instrument_buffer* buffer = nullptr;
+            bool finished = false;
+        };
+        inline thread_local instrument_thread currentInstrumentThread;
+
+        // Moves the exiting thread's counters into the retired totals
+        struct instrument_retirer
+        {
+            ~instrument_retirer()
+            {
+                auto& state = instrument_state();
+                auto& thread = currentInstrumentThread;
+                std::lock_guard lock(state.mutex);
+                fold(state.retired, *thread.buffer);
+                std::erase(state.buffers, thread.buffer);
+                delete thread.buffer;
+                thread.buffer = nullptr;
+                thread.finished = true;
+            }
+        };
+        inline thread_local instrument_retirer instrumentRetirer;
+
+        inline instrument_counts& instrument_counts_slow(const instrument_type& type)
+        {
+            auto& state = instrument_state();
+            auto& thread = currentInstrumentThread;
+            std::lock_guard lock(state.mutex);
+            if (!thread.buffer)
+            {
+                thread.buffer = new instrument_buffer();
+                state.buffers.push_back(thread.buffer);
+                // A thread whose retirer has already run keeps its buffer registered
+                if (!thread.finished)
+                {
+                    [[maybe_unused]] auto* retirer = &instrumentRetirer;
+                }
+            }
+            grow(*thread.buffer, state.types.size());
+            return *thread.buffer->counts[type.index];
+        }
+
+        inline instrument_counts& instrument_counts_for(const instrument_type& type)
+        {
+            auto* buffer = currentInstrumentThread.buffer;
+            if (buffer && type.index < buffer->counts.size())
+            {
+                return *buffer->counts[type.index];
+            }
+            return instrument_counts_slow(type);
+        }
+
+        template <typename T>
+        std::string instrument_type_name()
+        {
+            const char* mangled = typeid(T).name();
+#if __has_include(<cxxabi.h>)
+            int status = 0;
+            std::unique_ptr<char, decltype(&std::free)> demangled(abi::__cxa_demangle(mangled, nullptr, nullptr, &status), &std::free);
+            if (status == 0 && demangled)
+            {
+                return demangled.get();
+            }
+#endif
+            return mangled;
+        }
+
+        inline instrument_type& register_instrument_type(std::string name)
+        {
+            auto& state = instrument_state();
+            std::lock_guard lock(state.mutex);
+            auto& type = state.types.emplace_back();
+            type.index = state.types.size() - 1;
+            type.name = std::move(name);
+            return type;
+        }
+
+        template <typename T>
+        instrument_type& instrument_type_of()
+        {
+            static instrument_type& type = register_instrument_type(instrument_type_name<T>());
+            return type;
+        }
+
+        inline void instrument_allocated(instrument_type& type)
+        {
+            bump(instrument_counts_for(type).allocations);
+            std::int64_t live = type.live.fetch_add(1, std::memory_order_relaxed) + 1;
+            std::int64_t peak = type.peakLive.load(std::memory_order_relaxed);
+            while (live > peak && !type.peakLive.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        inline void instrument_destroyed(instrument_type& type)
+        {
+            bump(instrument_counts_for(type).destructions);
+            type.live.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Hooks the pointers call for an object of type T
+        template <typename T>
+        struct instrument
+        {
+            static void allocated() { instrument_allocated(instrument_type_of<T>()); }
+            static void destroyed() { instrument_destroyed(instrument_type_of<T>()); }
+            // The object leaves the pointers' care without being destroyed
+            static void released() { instrument_type_of<T>().live.fetch_sub(1, std::memory_order_relaxed); }
+            static void copied() { bump(instrument_counts_for(instrument_type_of<T>()).copies); }
+            static void moved() { bump(instrument_counts_for(instrument_type_of<T>()).moves); }
+        };
+
+        // Kept in each control block: the object's type and when it was taken
+        // into ownership, so the last release can record its lifetime
+        class lifetime_stamp
+        {
+          public:
+            template <typename T>
+            void start()
+            {
+                type = &instrument_type_of<T>();
+                instrument_allocated(*type);
+                created = std::chrono::steady_clock::now();
+            }
+
+            void finish()
+            {
+                if (!type)
+                {
+                    return;
+                }
+                auto lived = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - created).count();
+                auto nanoseconds = static_cast<std::uint64_t>(lived > 0 ? lived : 0);
+                std::size_t bucket = nanoseconds ? static_cast<std::size_t>(std::bit_width(nanoseconds) - 1) : 0;
+                bucket = std::min(bucket, instrumentation::LIFETIME_BUCKETS - 1);
+                bump(instrument_counts_for(*type).lifetimes[bucket]);
+                instrument_destroyed(*type);
+            }
+
+          private:
+            instrument_type* type = nullptr;
+            std::chrono::steady_clock::time_point created;
+        };
+    } // namespace detail
+
+    namespace instrumentation
+    {
+        // Sums every thread's counters, the exited ones included
+        inline std::vector<type_counters> snapshot()
+        {
+            auto& state = detail::instrument_state();
+            std::lock_guard lock(state.mutex);
+            detail::instrument_buffer totals;
+            detail::fold(totals, state.retired);
+            for (auto* buffer : state.buffers)
+            {
+                detail::fold(totals, *buffer);
+            }
+            detail::grow(totals, state.types.size());
+
+            std::vector<type_counters> result;
+            for (auto& type : state.types)
+            {
+                const auto& counts = *totals.counts[type.index];
+                type_counters counters;
+                counters.type = type.name;
+                counters.allocations = counts.allocations.load(std::memory_order_relaxed);
+                counters.destructions = counts.destructions.load(std::memory_order_relaxed);
+                counters.copies = counts.copies.load(std::memory_order_relaxed);
+                counters.moves = counts.moves.load(std::memory_order_relaxed);
+                counters.live = type.live.load(std::memory_order_relaxed);
+                counters.peakLive = type.peakLive.load(std::memory_order_relaxed);
+                for (std::size_t bucket = 0; bucket < LIFETIME_BUCKETS; bucket++)
+                {
+                    counters.lifetimes[bucket] = counts.lifetimes[bucket].load(std::memory_order_relaxed);
+                }
+                result.push_back(std::move(counters));
+            }
+            return result;
+        }
+    } // namespace instrumentation
+#else
+    namespace detail
+    {
+        template <typename T>
+        struct instrument
+        {
+            static void allocated() {}
+            static void destroyed() {}
+            static void released() {}
+            static void copied() {}
+            static void moved() {}
+        };
+
+        class lifetime_stamp
+        {
+          public:
+            template <typename T>
+            void start()
+            {
+            }
+            void finish() {}
+        };
+    } // namespace detail
+
+    namespace instrumentation
+    {
+        inline std::vector<type_counters> snapshot()
+        {
+            return {};
+        }
+    } // namespace instrumentation
+#endif
+
+    namespace instrumentation
+    {
+        // Writes a snapshot as one line per type followed by its non-empty
+        // lifetime buckets
+        inline void dump(std::ostream& out)
+        {
+            if (!enabled)
+            {
+                out << "usu instrumentation is disabled; build with USU_INSTRUMENTATION\n";
+                return;
+            }
+            for (const auto& counters : snapshot())
+            {
+                out << counters.type << ": allocations " << counters.allocations
+                    << ", destructions " << counters.destructions
+                    << ", copies " << counters.copies
+                    << ", moves " << counters.moves
+                    << ", live " << counters.live
+                    << ", peak live " << counters.peakLive << "\n";
+                for (std::size_t bucket = 0; bucket < LIFETIME_BUCKETS; bucket++)
+                {
+                    if (counters.lifetimes[bucket])
+                    {
+                        out << "    lived < 2^" << bucket + 1 << " ns: " << counters.lifetimes[bucket] << "\n";
+                    }
+                }
+            }
+        }
+    } // namespace instrumentation
+} // namespace usu
@@ -0,0 +1,180 @@
+#pragma once
+#include "access_policy.hpp"
+#include "ref_counter.hpp"
+#include "relocation.hpp"
+
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace usu
+{
+    // ------------------------------------------------------------------
+    //
+    // CRTP base that embeds a reference count in the object itself, so
+    // intrusive_ptr needs no control block. Counter is one of the policies
+    // from ref_counter.hpp. The last release deletes the object as a T.
+    //
+    // ------------------------------------------------------------------
+    template <typename T, typename Counter = thread_safe_counter>
+    class intrusive_ref_counter
+    {
+      public:
+        unsigned int use_count() const { return Counter::load(refCount); }
+
+        // Hooks found by argument-dependent lookup from intrusive_ptr. Types
+        // that keep their own count provide these two functions instead.
+        friend void intrusive_ptr_add_ref(const intrusive_ref_counter* object) { Counter::increment(object->refCount); }
+        friend void intrusive_ptr_release(const intrusive_ref_counter* object)
+        {
+            if (Counter::decrement(object->refCount))
+            {
+                delete static_cast<const T*>(object);
+            }
+        }
+
+      protected:
+        intrusive_ref_counter() :
+            refCount(0)
+        {
+        }
+        // A copy of the object starts with no owners of its own
+        intrusive_ref_counter(const intrusive_ref_counter&) :
+            refCount(0)
+        {
+        }
+        intrusive_ref_counter& operator=(const intrusive_ref_counter&) { return *this; }
+        ~intrusive_ref_counter() = default;
+
+      private:
+        mutable typename Counter::type refCount;
+    };
+
+    // Shared pointer to an object that carries its own count. It is one
+    // pointer wide, and copies touch only the object's cache line.
+    template <typename T>
+    class intrusive_ptr
+    {
+      public:
+        intrusive_ptr();
+        // Takes a reference unless addRef is false, which adopts one the caller already holds
+        intrusive_ptr(T* ptr, bool addRef = true);
+        intrusive_ptr(const intrusive_ptr<T>& otherIntrusive);
+        intrusive_ptr(intrusive_ptr<T>&& otherIntrusive) noexcept;
+
+        // Destructor
+        ~intrusive_ptr();
+
+        intrusive_ptr<T>& operator=(const intrusive_ptr<T>& otherIntrusive);
+        intrusive_ptr<T>& operator=(intrusive_ptr<T>&& otherIntrusive) noexcept;
+
+        T* get() const { return rawPointer; }
+        T* operator->() const { return rawPointer; }
+        T& operator*() const;
+
+        // Gives up ownership without releasing the reference
+        T* detach();
+        void reset();
+        void swap(intrusive_ptr<T>& otherIntrusive) noexcept { std::swap(rawPointer, otherIntrusive.rawPointer); }
+
+        bool operator==(const intrusive_ptr<T>& otherIntrusive) const { return rawPointer == otherIntrusive.rawPointer; }
+        bool operator!=(const intrusive_ptr<T>& otherIntrusive) const { return rawPointer != otherIntrusive.rawPointer; }
+
+      private:
+        T* rawPointer;
+    };
+
+    template <typename T>
+    intrusive_ptr<T>::intrusive_ptr() :
+        rawPointer(nullptr)
+    {
+    }
+
+    template <typename T>
+    intrusive_ptr<T>::intrusive_ptr(T* ptr, bool addRef) :
+        rawPointer(ptr)
+    {
+        if (rawPointer && addRef)
+        {
+            intrusive_ptr_add_ref(rawPointer);
+        }
+    }
+
+    // Copy constructor
+    template <typename T>
+    intrusive_ptr<T>::intrusive_ptr(const intrusive_ptr<T>& otherIntrusive) :
+        intrusive_ptr(otherIntrusive.rawPointer)
+    {
+    }
+
+    // Move constructor
+    template <typename T>
+    intrusive_ptr<T>::intrusive_ptr(intrusive_ptr<T>&& otherIntrusive) noexcept :
+        rawPointer(otherIntrusive.rawPointer)
+    {
+        otherIntrusive.rawPointer = nullptr;
+    }
+
+    // Destructor
+    template <typename T>
+    intrusive_ptr<T>::~intrusive_ptr()
+    {
+        reset();
+    }
+
+    // Copy assignment operator. The new reference is taken first, so assigning
+    // from a pointer owned by the current object is safe.
+    template <typename T>
+    intrusive_ptr<T>& intrusive_ptr<T>::operator=(const intrusive_ptr<T>& otherIntrusive)
+    {
+        intrusive_ptr<T>(otherIntrusive).swap(*this);
+        return *this;
+    }
+
+    // Move assignment operator
+    template <typename T>
+    intrusive_ptr<T>& intrusive_ptr<T>::operator=(intrusive_ptr<T>&& otherIntrusive) noexcept
+    {
+        intrusive_ptr<T>(std::move(otherIntrusive)).swap(*this);
+        return *this;
+    }
+
+    template <typename T>
+    T& intrusive_ptr<T>::operator*() const
+    {
+        default_access::require<std::runtime_error>(rawPointer != nullptr, "Attempting to dereference a null intrusive_ptr.");
+        return *rawPointer;
+    }
+
+    template <typename T>
+    T* intrusive_ptr<T>::detach()
+    {
+        T* temp = rawPointer;
+        rawPointer = nullptr;
+        return temp;
+    }
+
+    template <typename T>
+    void intrusive_ptr<T>::reset()
+    {
+        if (rawPointer)
+        {
+            T* temp = rawPointer;
+            rawPointer = nullptr;
+            intrusive_ptr_release(temp);
+        }
+    }
+
+    template <typename T, typename... Args>
+    intrusive_ptr<T> make_intrusive(Args&&... args)
+    {
+        return intrusive_ptr<T>(new T(std::forward<Args>(args)...));
+    }
+
+    template <typename T>
+    struct is_trivially_relocatable<intrusive_ptr<T>> : std::true_type
+    {
+    };
+
+    static_assert(sizeof(intrusive_ptr<int>) == sizeof(int*), "intrusive_ptr must be one pointer wide");
+} // namespace usu
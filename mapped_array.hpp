@@ -0,0 +1,192 @@
+#pragma once
+#include "shared_ptr.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace usu
+{
+    // How a file is mapped. read_only needs a const element type. read_write
+    // writes back to the file and is seen by every process mapping it;
+    // copy_on_write gives this process private copies of the pages it touches.
+    enum class map_mode
+    {
+        read_only,
+        read_write,
+        copy_on_write
+    };
+
+    // Access pattern passed to madvise
+    enum class map_advice
+    {
+        normal,
+        sequential,
+        random,
+        will_need
+    };
+
+    struct map_options
+    {
+        map_advice advice = map_advice::normal;
+        // Asks for transparent huge pages; ignored where the kernel or filesystem cannot
+        bool hugePages = false;
+        // Faults every page in up front (Linux only) instead of on first touch
+        bool populate = false;
+    };
+
+    namespace detail
+    {
+        // Block for an array that lives in a file mapping; the last owner unmaps it
+        template <typename T, typename Counter>
+        class mapped_block : public control_block<Counter>
+        {
+          public:
+            mapped_block(void* address, std::size_t length) :
+                address(address), length(length)
+            {
+            }
+
+            T* get() { return static_cast<T*>(address); }
+
+          protected:
+            void destroy_object() noexcept override { ::munmap(address, length); }
+            void deallocate() noexcept override
+            {
+                this->~mapped_block();
+                pool_allocator<mapped_block>().deallocate(this, 1);
+            }
+
+          private:
+            void* address;
+            std::size_t length;
+        };
+
+        // Closes the descriptor once the mapping exists or the attempt has failed
+        class file_descriptor
+        {
+          public:
+            explicit file_descriptor(int fd) :
+                fd(fd)
+            {
+            }
+            file_descriptor(const file_descriptor&) = delete;
+            file_descriptor& operator=(const file_descriptor&) = delete;
+
+            // Destructor
+            ~file_descriptor()
+            {
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                }
+            }
+
+            int fd;
+        };
+
+        inline void advise(void* address, std::size_t length, const map_options& options)
+        {
+            // Hints only: a kernel that rejects one still maps the file correctly
+            int advice = MADV_NORMAL;
+            switch (options.advice)
+            {
+                case map_advice::normal:
+                    advice = MADV_NORMAL;
+                    break;
+                case map_advice::sequential:
+                    advice = MADV_SEQUENTIAL;
+                    break;
+                case map_advice::random:
+                    advice = MADV_RANDOM;
+                    break;
+                case map_advice::will_need:
+                    advice = MADV_WILLNEED;
+                    break;
+            }
+            ::madvise(address, length, advice);
+#if defined(MADV_HUGEPAGE)
+            if (options.hugePages)
+            {
+                ::madvise(address, length, MADV_HUGEPAGE);
+            }
+#endif
+        }
+    } // namespace detail
+
+    // ------------------------------------------------------------------
+    //
+    // Shared array backed by a memory-mapped file. Returning is O(1) in
+    // the file size: pages are read on first touch, and read-only or
+    // read_write mappings of the same file share one copy in the page cache
+    // across every process that maps it. munmap runs when the last owner,
+    // slices included, lets go. The file's size must be a multiple of
+    // sizeof(T); an empty file gives an empty pointer.
+    //
+    // ------------------------------------------------------------------
+    template <typename T, typename Counter = thread_safe_counter>
+    shared_ptr<T[], Counter> map_shared_array(const std::string& path, map_mode mode = map_mode::read_only, map_options options = {})
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Mapped elements must be trivially copyable");
+        if (mode == map_mode::read_only && !std::is_const_v<T>)
+        {
+            throw std::runtime_error("A read-only mapping needs a const element type.");
+        }
+
+        detail::file_descriptor file(::open(path.c_str(), mode == map_mode::read_write ? O_RDWR : O_RDONLY));
+        if (file.fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+        }
+        struct stat status;
+        if (::fstat(file.fd, &status) != 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Cannot stat " + path);
+        }
+        auto length = static_cast<std::size_t>(status.st_size);
+        if (length % sizeof(T) != 0)
+        {
+            throw std::runtime_error("File size is not a multiple of the element size: " + path);
+        }
+        if (length == 0)
+        {
+            return shared_ptr<T[], Counter>();
+        }
+
+        int protection = (mode == map_mode::read_only) ? PROT_READ : PROT_READ | PROT_WRITE;
+        int flags = (mode == map_mode::copy_on_write) ? MAP_PRIVATE : MAP_SHARED;
+#if defined(MAP_POPULATE)
+        if (options.populate)
+        {
+            flags |= MAP_POPULATE;
+        }
+#endif
+        void* address = ::mmap(nullptr, length, protection, flags, file.fd, 0);
+        if (address == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), "Cannot map " + path);
+        }
+        detail::advise(address, length, options);
+
+        using block = detail::mapped_block<T, Counter>;
+        try
+        {
+            return detail::adopt_array<T, Counter>(detail::allocate_block<block>(pool_allocator<block>(), address, length), length / sizeof(T));
+        }
+        catch (...)
+        {
+            ::munmap(address, length);
+            throw;
+        }
+    }
+} // namespace usu
+#endif
@@ -0,0 +1,187 @@
+#pragma once
+#include "shared_ptr.hpp"
+#include "thread_record.hpp"
+#include "unique_ptr.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace usu
+{
+    template <typename T>
+    class object_pool;
+
+    namespace detail
+    {
+        // One thread's stash of idle objects in a pool
+        template <typename T>
+        struct pool_record
+        {
+            std::vector<T*> idle;
+            std::atomic<bool> inUse{ true };
+            pool_record* next = nullptr;
+        };
+
+        // Shared state of an object_pool, owned by the pool. Idle objects live in
+        // the per-thread records; the shared list only moves batches between
+        // threads that release more than they acquire and the other way round.
+        template <typename T>
+        class object_pool_state
+        {
+          public:
+            object_pool_state() = default;
+            object_pool_state(const object_pool_state&) = delete;
+            object_pool_state& operator=(const object_pool_state&) = delete;
+
+            // Destructor, which deletes every idle object
+            ~object_pool_state();
+
+            using record_type = pool_record<T>;
+            pool_record<T>* acquireRecord() { return acquire_record(records); }
+
+            std::atomic<pool_record<T>*> records{ nullptr };
+            std::mutex sharedMutex;
+            std::vector<T*> shared;
+        };
+
+        template <typename T>
+        object_pool_state<T>::~object_pool_state()
+        {
+            pool_record<T>* record = records.load(std::memory_order_acquire);
+            while (record)
+            {
+                for (T* object : record->idle)
+                {
+                    delete object;
+                }
+                pool_record<T>* next = record->next;
+                delete record;
+                record = next;
+            }
+            for (T* object : shared)
+            {
+                delete object;
+            }
+        }
+    } // namespace detail
+
+    // Deleter that hands the object back to its pool
+    template <typename T>
+    class pool_delete
+    {
+      public:
+        pool_delete() :
+            owner(nullptr)
+        {
+        }
+        explicit pool_delete(object_pool<T>& owner) :
+            owner(&owner)
+        {
+        }
+
+        void operator()(T* ptr) const { owner->recycle(ptr); }
+
+      private:
+        object_pool<T>* owner;
+    };
+
+    template <typename T>
+    using pool_ptr = unique_ptr<T, pool_delete<T>>;
+
+    // ------------------------------------------------------------------
+    //
+    // Recycles objects that are expensive to build. acquire() hands out an
+    // idle object when there is one and builds a new one otherwise; when
+    // the pool_ptr lets go the object goes back to the pool, after the
+    // reset hook (if any) has cleared it, instead of being deleted. Each
+    // thread keeps up to CACHE idle objects of its own, so acquire and
+    // release take no lock until a thread's stash runs dry or overflows
+    // and a batch moves through the shared list.
+    //
+    // The pool must outlive every pool_ptr it hands out, and the reset
+    // hook must not throw.
+    //
+    // ------------------------------------------------------------------
+    template <typename T>
+    class object_pool
+    {
+      public:
+        // Idle objects each thread keeps before spilling half to the shared list
+        static constexpr std::size_t CACHE = 32;
+
+        // reset clears a returned object for its next user; create builds new ones
+        explicit object_pool(std::function<void(T&)> reset = nullptr,
+                             std::function<unique_ptr<T>()> create = []
+                             { return make_unique<T>(); });
+        object_pool(const object_pool&) = delete;
+        object_pool& operator=(const object_pool&) = delete;
+
+        pool_ptr<T> acquire();
+
+        // Number of objects the pool has built so far
+        std::size_t constructed() const { return constructedCount.load(std::memory_order_relaxed); }
+
+      private:
+        friend class pool_delete<T>;
+
+        void recycle(T* object);
+        detail::pool_record<T>& localRecord() { return detail::local_record(state); }
+
+        std::function<void(T&)> reset;
+        std::function<unique_ptr<T>()> create;
+        std::atomic<std::size_t> constructedCount{ 0 };
+        shared_ptr<detail::object_pool_state<T>> state;
+    };
+
+    template <typename T>
+    object_pool<T>::object_pool(std::function<void(T&)> reset, std::function<unique_ptr<T>()> create) :
+        reset(std::move(reset)), create(std::move(create)), state(make_shared<detail::object_pool_state<T>>())
+    {
+    }
+
+    template <typename T>
+    pool_ptr<T> object_pool<T>::acquire()
+    {
+        auto& record = localRecord();
+        if (record.idle.empty())
+        {
+            // Refill half a stash from the shared list in one go
+            std::lock_guard lock(state->sharedMutex);
+            std::size_t take = std::min(state->shared.size(), CACHE / 2);
+            record.idle.insert(record.idle.end(), state->shared.end() - take, state->shared.end());
+            state->shared.resize(state->shared.size() - take);
+        }
+        if (record.idle.empty())
+        {
+            auto created = create();
+            constructedCount.fetch_add(1, std::memory_order_relaxed);
+            return pool_ptr<T>(created.release(), pool_delete<T>(*this));
+        }
+        T* object = record.idle.back();
+        record.idle.pop_back();
+        return pool_ptr<T>(object, pool_delete<T>(*this));
+    }
+
+    template <typename T>
+    void object_pool<T>::recycle(T* object)
+    {
+        if (reset)
+        {
+            reset(*object);
+        }
+        auto& record = localRecord();
+        record.idle.push_back(object);
+        if (record.idle.size() > CACHE)
+        {
+            // Spill the older half so a thread that only releases cannot hoard objects
+            std::lock_guard lock(state->sharedMutex);
+            state->shared.insert(state->shared.end(), record.idle.begin(), record.idle.begin() + CACHE / 2);
+            record.idle.erase(record.idle.begin(), record.idle.begin() + CACHE / 2);
+        }
+    }
+} // namespace usu
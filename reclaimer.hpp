@@ -0,0 +1,317 @@
+#pragma once
+#include "shared_ptr.hpp"
+#include "unique_ptr.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace usu
+{
+    // ------------------------------------------------------------------
+    //
+    // Runs destructors away from the thread that dropped the last owner.
+    // Dying objects go onto a bounded lock-free queue (Vyukov's MPMC ring)
+    // and are destroyed by drain(), or by a background thread once start()
+    // has been called. The queue never grows: when it is full the caller
+    // destroys the object inline, which slows producers down to the rate
+    // the reclaimer keeps up with.
+    //
+    // ------------------------------------------------------------------
+    class reclaimer
+    {
+      public:
+        using destroy_fn = void (*)(void*);
+
+        // Capacity is rounded up to a power of two
+        explicit reclaimer(std::size_t capacity = 4096);
+        reclaimer(const reclaimer&) = delete;
+        reclaimer& operator=(const reclaimer&) = delete;
+
+        // Destructor, which stops the background thread and drains the queue
+        ~reclaimer();
+
+        // Queues destroy(object), or runs it right here if the queue is full.
+        // Returns false when it ran inline.
+        bool defer(destroy_fn destroy, void* object);
+
+        // Runs everything queued so far and returns how many objects it destroyed
+        std::size_t drain();
+
+        // Starts or stops a background thread that drains as work arrives
+        void start();
+        void stop();
+
+        // Number of destructions that had to run inline because the queue was full
+        std::size_t overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+
+      private:
+        struct alignas(64) slot
+        {
+            std::atomic<std::size_t> sequence;
+            destroy_fn destroy;
+            void* object;
+        };
+
+        bool tryPush(destroy_fn destroy, void* object);
+        bool tryPop(destroy_fn& destroy, void*& object);
+        void run();
+
+        std::unique_ptr<slot[]> slots;
+        std::size_t mask;
+        alignas(64) std::atomic<std::size_t> head{ 0 };
+        alignas(64) std::atomic<std::size_t> tail{ 0 };
+        // Bumped on every push so the background thread can sleep until work arrives
+        alignas(64) std::atomic<std::uint32_t> pushes{ 0 };
+        std::atomic<bool> stopping{ false };
+        std::atomic<std::size_t> overflowCount{ 0 };
+        std::thread worker;
+    };
+
+    inline reclaimer::reclaimer(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+        slots = std::make_unique<slot[]>(size);
+        mask = size - 1;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Destructor
+    inline reclaimer::~reclaimer()
+    {
+        stop();
+        drain();
+    }
+
+    inline bool reclaimer::defer(destroy_fn destroy, void* object)
+    {
+        if (tryPush(destroy, object))
+        {
+            pushes.fetch_add(1, std::memory_order_release);
+            pushes.notify_one();
+            return true;
+        }
+        overflowCount.fetch_add(1, std::memory_order_relaxed);
+        destroy(object);
+        return false;
+    }
+
+    inline std::size_t reclaimer::drain()
+    {
+        std::size_t destroyed = 0;
+        destroy_fn destroy;
+        void* object;
+        while (tryPop(destroy, object))
+        {
+            destroy(object);
+            destroyed++;
+        }
+        return destroyed;
+    }
+
+    inline void reclaimer::start()
+    {
+        if (!worker.joinable())
+        {
+            stopping.store(false, std::memory_order_relaxed);
+            worker = std::thread([this]
+                                 { run(); });
+        }
+    }
+
+    inline void reclaimer::stop()
+    {
+        if (worker.joinable())
+        {
+            stopping.store(true, std::memory_order_relaxed);
+            pushes.fetch_add(1, std::memory_order_release);
+            pushes.notify_one();
+            worker.join();
+        }
+    }
+
+    inline void reclaimer::run()
+    {
+        while (true)
+        {
+            // Read the push count before checking for stop, so stop()'s bump is never missed
+            std::uint32_t seen = pushes.load(std::memory_order_acquire);
+            if (stopping.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            if (drain() == 0)
+            {
+                pushes.wait(seen, std::memory_order_acquire);
+            }
+        }
+    }
+
+    // A slot is free for the push at position p when its sequence is p, and holds
+    // the item for the pop at position p when its sequence is p + 1
+    inline bool reclaimer::tryPush(destroy_fn destroy, void* object)
+    {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot& target = slots[position & mask];
+            std::size_t sequence = target.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0)
+            {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    target.destroy = destroy;
+                    target.object = object;
+                    target.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    inline bool reclaimer::tryPop(destroy_fn& destroy, void*& object)
+    {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            slot& target = slots[position & mask];
+            std::size_t sequence = target.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (difference == 0)
+            {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    destroy = target.destroy;
+                    object = target.object;
+                    target.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Process-wide reclaimer with a background thread, used when none is given
+    inline reclaimer& default_reclaimer()
+    {
+        struct background_reclaimer : reclaimer
+        {
+            background_reclaimer() { start(); }
+        };
+        static background_reclaimer instance;
+        return instance;
+    }
+
+    namespace detail
+    {
+        // make_shared block whose object is destroyed by a reclaimer. When the last
+        // owner lets go the block takes a weak reference for the queue, so the
+        // storage stays valid until the reclaimer has run the destructor.
+        template <typename T, typename Counter>
+        class deferred_block : public control_block<Counter>
+        {
+          public:
+            template <typename... Args>
+            explicit deferred_block(reclaimer& owner, Args&&... args) :
+                owner(&owner), object(std::forward<Args>(args)...)
+            {
+            }
+
+            T* get() { return &object; }
+
+          protected:
+            ~deferred_block() override {}
+
+            void destroy_object() noexcept override
+            {
+                this->increment_weak();
+                owner->defer(&finish, this);
+            }
+            void deallocate() noexcept override
+            {
+                this->~deferred_block();
+                pool_allocator<deferred_block>().deallocate(this, 1);
+            }
+
+          private:
+            static void finish(void* block)
+            {
+                auto self = static_cast<deferred_block*>(block);
+                self->object.~T();
+                self->release_weak();
+            }
+
+            reclaimer* owner;
+            union
+            {
+                T object;
+            };
+        };
+    } // namespace detail
+
+    // make_shared whose object is destroyed by the reclaimer instead of by the
+    // thread that drops the last owner
+    template <typename T, typename... Args>
+    shared_ptr<T> make_shared_deferred(reclaimer& owner, Args&&... args)
+    {
+        auto newBlock = detail::allocate_block<detail::deferred_block<T, thread_safe_counter>>(pool_allocator<T>(), owner, std::forward<Args>(args)...);
+        return detail::adopt_inplace<T, thread_safe_counter>(newBlock);
+    }
+
+    template <typename T, typename... Args>
+    shared_ptr<T> make_shared_deferred(Args&&... args)
+    {
+        return make_shared_deferred<T>(default_reclaimer(), std::forward<Args>(args)...);
+    }
+
+    // unique_ptr deleter that hands the object to a reclaimer
+    template <typename T>
+    class deferred_delete
+    {
+      public:
+        deferred_delete() :
+            owner(&default_reclaimer())
+        {
+        }
+        explicit deferred_delete(reclaimer& owner) :
+            owner(&owner)
+        {
+        }
+
+        void operator()(T* ptr) const
+        {
+            owner->defer([](void* object)
+                         { delete static_cast<T*>(object); },
+                         ptr);
+        }
+
+      private:
+        reclaimer* owner;
+    };
+} // namespace usu
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+
+// ------------------------------------------------------------------
+//
+// Counting policies shared by the reference counted pointers. Each
+// policy names the storage for a count and the operations on it.
+//
+// ------------------------------------------------------------------
+namespace usu
+{
+    // Safe to copy and destroy owners from any number of threads
+    struct thread_safe_counter
+    {
+        using type = std::atomic<unsigned int>;
+
+        static unsigned int load(const type& count) { return count.load(std::memory_order_relaxed); }
+        // Also sees every write made by owners that have since released their reference
+        static unsigned int load_acquire(const type& count) { return count.load(std::memory_order_acquire); }
+
+        // A new owner is always made from an existing one, so no ordering is needed
+        static void increment(type& count) { count.fetch_add(1, std::memory_order_relaxed); }
+
+        // Returns true when the last reference has been released. acq_rel makes every
+        // owner's writes visible to the thread that ends up destroying the object.
+        static bool decrement(type& count) { return count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+        // Adds a reference only if one is still held, used to promote weak references
+        static bool increment_if_nonzero(type& count)
+        {
+            unsigned int current = count.load(std::memory_order_relaxed);
+            while (current != 0)
+            {
+                if (count.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    // Plain integer updates for objects that never leave one thread
+    struct thread_unsafe_counter
+    {
+        using type = unsigned int;
+
+        static unsigned int load(const type& count) { return count; }
+        static unsigned int load_acquire(const type& count) { return count; }
+        static void increment(type& count) { count++; }
+        static bool decrement(type& count) { return --count == 0; }
+
+        static bool increment_if_nonzero(type& count)
+        {
+            if (count == 0)
+            {
+                return false;
+            }
+            count++;
+            return true;
+        }
+    };
+} // namespace usu
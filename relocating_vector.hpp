@@ -0,0 +1,185 @@
+#pragma once
+#include "access_policy.hpp"
+#include "relocation.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace usu
+{
+    // ------------------------------------------------------------------
+    //
+    // Growable array that moves its elements to new storage with
+    // relocate(), so trivially relocatable elements such as the smart
+    // pointers are moved with one memcpy instead of a constructor and a
+    // destructor per element. Elements must be trivially relocatable or
+    // nothrow movable.
+    //
+    // ------------------------------------------------------------------
+    template <typename T>
+    class relocating_vector
+    {
+      public:
+        relocating_vector() = default;
+        relocating_vector(const relocating_vector&) = delete;
+        relocating_vector(relocating_vector&& otherVector) noexcept;
+
+        // Destructor
+        ~relocating_vector();
+
+        relocating_vector& operator=(const relocating_vector&) = delete;
+        relocating_vector& operator=(relocating_vector&& otherVector) noexcept;
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args);
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+        void pop_back();
+        void reserve(std::size_t newCapacity);
+        void clear();
+
+        T& operator[](std::size_t index);
+        const T& operator[](std::size_t index) const;
+
+        std::size_t size() const { return count; }
+        std::size_t capacity() const { return slots; }
+        bool empty() const { return count == 0; }
+        T* data() const { return elements; }
+        T* begin() const { return elements; }
+        T* end() const { return elements + count; }
+
+      private:
+        // Moves the elements into storage for newCapacity of them
+        void grow(std::size_t newCapacity);
+        // Hands back storage that holds no live elements
+        void freeStorage();
+
+        T* elements = nullptr;
+        std::size_t count = 0;
+        std::size_t slots = 0;
+    };
+
+    // Move constructor
+    template <typename T>
+    relocating_vector<T>::relocating_vector(relocating_vector&& otherVector) noexcept :
+        elements(otherVector.elements), count(otherVector.count), slots(otherVector.slots)
+    {
+        otherVector.elements = nullptr;
+        otherVector.count = 0;
+        otherVector.slots = 0;
+    }
+
+    // Destructor
+    template <typename T>
+    relocating_vector<T>::~relocating_vector()
+    {
+        clear();
+        freeStorage();
+    }
+
+    // Move assignment operator
+    template <typename T>
+    relocating_vector<T>& relocating_vector<T>::operator=(relocating_vector&& otherVector) noexcept
+    {
+        if (this != &otherVector)
+        {
+            clear();
+            freeStorage();
+            elements = std::exchange(otherVector.elements, nullptr);
+            count = std::exchange(otherVector.count, 0);
+            slots = std::exchange(otherVector.slots, 0);
+        }
+        return *this;
+    }
+
+    template <typename T>
+    template <typename... Args>
+    T& relocating_vector<T>::emplace_back(Args&&... args)
+    {
+        if (count < slots)
+        {
+            std::construct_at(elements + count, std::forward<Args>(args)...);
+            return elements[count++];
+        }
+
+        // Build the new element in the new storage before relocating, so args may
+        // refer to an element of this vector
+        std::size_t newCapacity = slots ? slots * 2 : 8;
+        T* newElements = std::allocator<T>().allocate(newCapacity);
+        try
+        {
+            std::construct_at(newElements + count, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            std::allocator<T>().deallocate(newElements, newCapacity);
+            throw;
+        }
+        relocate(elements, count, newElements);
+        freeStorage();
+        elements = newElements;
+        slots = newCapacity;
+        return elements[count++];
+    }
+
+    template <typename T>
+    void relocating_vector<T>::pop_back()
+    {
+        if (count == 0)
+        {
+            throw std::out_of_range("pop_back on an empty relocating_vector.");
+        }
+        std::destroy_at(elements + --count);
+    }
+
+    template <typename T>
+    void relocating_vector<T>::reserve(std::size_t newCapacity)
+    {
+        if (newCapacity > slots)
+        {
+            grow(newCapacity);
+        }
+    }
+
+    template <typename T>
+    void relocating_vector<T>::clear()
+    {
+        std::destroy_n(elements, count);
+        count = 0;
+    }
+
+    template <typename T>
+    T& relocating_vector<T>::operator[](std::size_t index)
+    {
+        default_access::require<std::out_of_range>(index < count, "Index out of bounds.");
+        return elements[index];
+    }
+
+    template <typename T>
+    const T& relocating_vector<T>::operator[](std::size_t index) const
+    {
+        default_access::require<std::out_of_range>(index < count, "Index out of bounds.");
+        return elements[index];
+    }
+
+    template <typename T>
+    void relocating_vector<T>::grow(std::size_t newCapacity)
+    {
+        T* newElements = std::allocator<T>().allocate(newCapacity);
+        relocate(elements, count, newElements);
+        freeStorage();
+        elements = newElements;
+        slots = newCapacity;
+    }
+
+    template <typename T>
+    void relocating_vector<T>::freeStorage()
+    {
+        if (elements)
+        {
+            std::allocator<T>().deallocate(elements, slots);
+        }
+    }
+} // namespace usu
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace usu
+{
+    // ------------------------------------------------------------------
+    //
+    // A type is trivially relocatable when moving an object to new storage
+    // and destroying the original does the same as copying its bytes and
+    // forgetting the original. That holds for every trivially copyable
+    // type, and for the smart pointers, which specialize the trait next to
+    // their definitions: moving one is a pointer copy plus nulling the
+    // source, and destroying the null source does nothing. Containers can
+    // then grow with memcpy and never touch a reference count.
+    //
+    // ------------------------------------------------------------------
+    template <typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T>
+    {
+    };
+
+    template <typename T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+    // Moves count objects into uninitialized, non-overlapping storage at dest and
+    // ends the lifetime of the originals
+    template <typename T>
+    void relocate(T* first, std::size_t count, T* dest) noexcept
+    {
+        static_assert(is_trivially_relocatable_v<T> || std::is_nothrow_move_constructible_v<T>,
+                      "relocate needs a trivially relocatable or nothrow movable type");
+        if constexpr (is_trivially_relocatable_v<T>)
+        {
+            if (count != 0)
+            {
+                std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), count * sizeof(T));
+            }
+        }
+        else
+        {
+            std::uninitialized_move_n(first, count, dest);
+            std::destroy_n(first, count);
+        }
+    }
+} // namespace usu
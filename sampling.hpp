@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+#include <cstdlib>
+#include <cxxabi.h>
+#include <memory>
+#endif
+
+// ------------------------------------------------------------------
+//
+// Sampling registry of live objects, for finding what keeps memory
+// alive in a running process. Once set_interval(n) is called, about one
+// in n objects built by make_shared or make_unique is recorded with the
+// place it was made; the record goes away when the object does.
+// top_sites() ranks the places by the live bytes they account for,
+// scaled up by the interval each sample stood for.
+//
+// It is off until an interval is set. While off, make_shared and
+// make_unique pay one relaxed load and a branch, and the pointers'
+// destruction paths the same; everything else sits in out-of-line cold
+// functions. While on, an unsampled make pays a thread-local countdown,
+// and a destruction also checks one counter in a small filter. Only
+// sampled objects take the registry lock.
+//
+// Samples are grouped by site and by the type of the object.
+// make_shared_at and make_unique_at take the site as their first
+// argument, usually std::source_location::current(). make_shared and
+// make_unique cannot see their caller, so their samples have an unknown
+// site and are told apart only by type: every plain make of the same
+// type lands in one report, wherever it was called from.
+//
+// ------------------------------------------------------------------
+
+// Keeps the sampler's slow paths out of line, so the makers and
+// destructors that guard them stay small enough to inline
+#if defined(__GNUC__) || defined(__clang__)
+#define USU_COLD [[gnu::cold, gnu::noinline]]
+#elif defined(_MSC_VER)
+#define USU_COLD __declspec(noinline)
+#else
+#define USU_COLD
+#endif
+
+namespace usu
+{
+    namespace sampling
+    {
+        struct sample
+        {
+            std::source_location site;
+            // The type of the object, demangled where the platform allows
+            std::string type;
+            // Size of the allocation the object lives in
+            std::size_t bytes = 0;
+            // Allocations the sample stands for: the interval when it was taken
+            std::size_t weight = 0;
+            // Current strong owners; 1 for objects held by unique_ptr
+            unsigned int useCount = 0;
+        };
+
+        struct site_report
+        {
+            std::source_location site;
+            std::string type;
+            std::size_t samples = 0;
+            std::size_t sampledBytes = 0;
+            // sampledBytes scaled by each sample's weight
+            std::size_t estimatedBytes = 0;
+            unsigned int maxUseCount = 0;
+        };
+    } // namespace sampling
+
+    namespace detail
+    {
+        struct sample_record
+        {
+            std::source_location site;
+            // typeid(T).name() of the object
+            const char* typeName;
+            std::size_t bytes;
+            std::size_t weight;
+            // Reads the strong count of the sampled block, or null for unique_ptr
+            unsigned int (*useCount)(const void* key);
+        };
+
+        struct sample_registry
+        {
+            std::mutex mutex;
+            std::unordered_map<const void*, sample_record> live;
+        };
+
+        // Never destroyed, so objects freed by static destructors can still be forgotten
+        inline sample_registry& sample_state()
+        {
+            static auto* state = new sample_registry();
+            return *state;
+        }
+
+        inline std::atomic<std::size_t> sampleInterval{ 0 };
+        // Bumped by every set_interval, so each thread redraws its countdown
+        inline std::atomic<std::uint64_t> sampleGeneration{ 0 };
+        inline std::atomic<std::size_t> liveSamples{ 0 };
+
+        // Counting filter over the sampled addresses: a zero slot means the
+        // address is certainly not sampled, so the lock is only taken for
+        // sampled objects and the rare collision
+        constexpr std::size_t SAMPLE_FILTER_SLOTS = 1 << 14;
+        inline std::array<std::atomic<std::uint32_t>, SAMPLE_FILTER_SLOTS> sampleFilter{};
+
+        inline std::atomic<std::uint32_t>& sample_filter_slot(const void* key)
+        {
+            auto bits = reinterpret_cast<std::uintptr_t>(key);
+            return sampleFilter[((bits >> 4) * 0x9E3779B97F4A7C15ull >> 40) % SAMPLE_FILTER_SLOTS];
+        }
+
+        // Allocations left before this thread takes its next sample. The gap is
+        // drawn at random around the interval so periodic allocation patterns
+        // cannot hide from the sampler. It is first drawn, and drawn again, on
+        // the thread's first allocation under each new interval.
+        struct sample_countdown
+        {
+            std::int64_t remaining = 0;
+            // The sampleGeneration remaining was drawn under; 0 before the first draw
+            std::uint64_t generation = 0;
+            std::uint64_t random = 0x2545F4914F6CDD1Dull;
+
+            std::int64_t next(std::size_t interval)
+            {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+                return static_cast<std::int64_t>(1 + random % (2 * interval - 1));
+            }
+        };
+        inline thread_local sample_countdown sampleCountdown;
+
+        inline void remember_sample(const void* key, const sample_record& record) noexcept
+        {
+            try
+            {
+                auto& state = sample_state();
+                std::lock_guard lock(state.mutex);
+                if (state.live.emplace(key, record).second)
+                {
+                    sample_filter_slot(key).fetch_add(1, std::memory_order_relaxed);
+                    liveSamples.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            catch (...)
+            {
+                // Losing a sample beats failing the allocation it describes
+            }
+        }
+
+        // Counts the allocation at key down to this thread's next sample and
+        // takes it if its turn has come
+        USU_COLD inline void sample_allocation(const void* key, std::source_location site, const char* typeName, std::size_t bytes, unsigned int (*useCount)(const void*)) noexcept
+        {
+            std::uint64_t generation = sampleGeneration.load(std::memory_order_acquire);
+            std::size_t interval = sampleInterval.load(std::memory_order_relaxed);
+            if (interval == 0)
+            {
+                return;
+            }
+            auto& countdown = sampleCountdown;
+            if (countdown.generation != generation)
+            {
+                if (countdown.generation == 0)
+                {
+                    // Each thread starts from its own point, so short-lived threads do not all draw the same gap
+                    countdown.random = (countdown.random ^ reinterpret_cast<std::uintptr_t>(&countdown) * 0x9E3779B97F4A7C15ull) | 1;
+                }
+                countdown.generation = generation;
+                countdown.remaining = countdown.next(interval);
+            }
+            if (--countdown.remaining > 0)
+            {
+                return;
+            }
+            countdown.remaining = countdown.next(interval);
+            remember_sample(key, { site, typeName, bytes, interval, useCount });
+        }
+
+        // make_unique_at's call, with the type and size folded in to keep the call short
+        template <typename T>
+        USU_COLD void sample_object(const void* object, std::source_location site) noexcept
+        {
+            sample_allocation(object, site, typeid(T).name(), sizeof(T), nullptr);
+        }
+
+        inline std::string sample_type_name(const char* mangled)
+        {
+#if __has_include(<cxxabi.h>)
+            int status = 0;
+            std::unique_ptr<char, decltype(&std::free)> demangled(abi::__cxa_demangle(mangled, nullptr, nullptr, &status), &std::free);
+            if (status == 0 && demangled)
+            {
+                return demangled.get();
+            }
+#endif
+            return mangled;
+        }
+
+        // True while sampling is on; the makers only call into the sampler then
+        inline bool sampling_on()
+        {
+            return sampleInterval.load(std::memory_order_relaxed) != 0;
+        }
+
+        // Only reached while some sample is live, so the filter is read here
+        USU_COLD inline void forget_sample_slow(const void* key) noexcept
+        {
+            if (sample_filter_slot(key).load(std::memory_order_relaxed) == 0)
+            {
+                return;
+            }
+            auto& state = sample_state();
+            std::lock_guard lock(state.mutex);
+            if (state.live.erase(key))
+            {
+                sample_filter_slot(key).fetch_sub(1, std::memory_order_relaxed);
+                liveSamples.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Called as an object leaves the pointers' care, sampled or not
+        inline void forget_sample(const void* key)
+        {
+            if (liveSamples.load(std::memory_order_relaxed) != 0) [[unlikely]]
+            {
+                forget_sample_slow(key);
+            }
+        }
+    } // namespace detail
+
+    namespace sampling
+    {
+        // Samples about one in interval allocations from now on; 0 stops sampling.
+        // Samples already taken stay until their objects are destroyed.
+        inline void set_interval(std::size_t interval)
+        {
+            detail::sampleInterval.store(interval, std::memory_order_relaxed);
+            detail::sampleGeneration.fetch_add(1, std::memory_order_release);
+        }
+
+        inline std::size_t interval()
+        {
+            return detail::sampleInterval.load(std::memory_order_relaxed);
+        }
+
+        inline std::vector<sample> live_samples()
+        {
+            auto& state = detail::sample_state();
+            std::lock_guard lock(state.mutex);
+            std::vector<sample> samples;
+            samples.reserve(state.live.size());
+            for (const auto& [key, record] : state.live)
+            {
+                unsigned int useCount = record.useCount ? record.useCount(key) : 1;
+                samples.push_back({ record.site, detail::sample_type_name(record.typeName), record.bytes, record.weight, useCount });
+            }
+            return samples;
+        }
+
+        // The count sites holding the most estimated live bytes, largest first.
+        // Objects of different types made at the same site are reported apart.
+        inline std::vector<site_report> top_sites(std::size_t count = 10)
+        {
+            auto sameSite = [](const std::source_location& a, const std::source_location& b)
+            {
+                return a.line() == b.line() && a.column() == b.column() &&
+                       std::string_view(a.file_name()) == b.file_name() &&
+                       std::string_view(a.function_name()) == b.function_name();
+            };
+
+            std::vector<site_report> sites;
+            for (const auto& taken : live_samples())
+            {
+                auto site = std::find_if(sites.begin(), sites.end(), [&](const site_report& report)
+                                         { return sameSite(report.site, taken.site) && report.type == taken.type; });
+                if (site == sites.end())
+                {
+                    site = sites.insert(sites.end(), site_report{ taken.site, taken.type });
+                }
+                site->samples++;
+                site->sampledBytes += taken.bytes;
+                site->estimatedBytes += taken.bytes * taken.weight;
+                site->maxUseCount = std::max(site->maxUseCount, taken.useCount);
+            }
+            std::sort(sites.begin(), sites.end(), [](const site_report& a, const site_report& b)
+                      { return a.estimatedBytes > b.estimatedBytes; });
+            if (sites.size() > count)
+            {
+                sites.resize(count);
+            }
+            return sites;
+        }
+
+        // Writes top_sites(count), one line per site
+        inline void dump(std::ostream& out, std::size_t count = 10)
+        {
+            for (const auto& site : top_sites(count))
+            {
+                out << (site.site.line() ? site.site.file_name() : "<unknown site>") << ":" << site.site.line()
+                    << " " << site.site.function_name() << " " << site.type
+                    << ": ~" << site.estimatedBytes << " bytes live (" << site.samples << " samples, "
+                    << site.sampledBytes << " bytes sampled, max use_count " << site.maxUseCount << ")\n";
+            }
+        }
+    } // namespace sampling
+} // namespace usu
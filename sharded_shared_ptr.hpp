@@ -0,0 +1,211 @@
+#pragma once
+#include "thread_index.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace usu
+{
+    namespace detail
+    {
+        // Object plus a reference count split across cache-line sized shards. Each
+        // handle counts in the shard of the thread that created it. liveShards is
+        // the number of shards with a non-zero count, so it is only touched when a
+        // shard goes from zero to one or back; the object dies when it reaches zero.
+        template <typename T, unsigned int Shards>
+        class sharded_block
+        {
+          public:
+            template <typename... Args>
+            explicit sharded_block(unsigned int firstShard, Args&&... args) :
+                liveShards(1), object(std::forward<Args>(args)...)
+            {
+                shards[firstShard].count.store(1, std::memory_order_relaxed);
+            }
+
+            T* get() { return &object; }
+
+            // The caller already holds a reference, so the object cannot die here
+            void acquire(unsigned int shard)
+            {
+                if (shards[shard].count.fetch_add(1, std::memory_order_relaxed) == 0)
+                {
+                    liveShards.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            // Returns true when the last reference in every shard is gone
+            bool release(unsigned int shard)
+            {
+                if (shards[shard].count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    return liveShards.fetch_sub(1, std::memory_order_acq_rel) == 1;
+                }
+                return false;
+            }
+
+            // Sum of the shards; only a snapshot while other threads are copying
+            unsigned int use_count() const
+            {
+                unsigned int total = 0;
+                for (auto& shard : shards)
+                {
+                    total += shard.count.load(std::memory_order_relaxed);
+                }
+                return total;
+            }
+
+          private:
+            struct alignas(64) slot
+            {
+                std::atomic<unsigned int> count{ 0 };
+            };
+
+            alignas(64) std::atomic<unsigned int> liveShards;
+            slot shards[Shards];
+            T object;
+        };
+    } // namespace detail
+
+    // ------------------------------------------------------------------
+    //
+    // Shared pointer for objects copied by many threads at once. Copies made
+    // on different threads update different cache lines, so they do not
+    // contend the way a single count does. The shared count of live shards
+    // is only updated when a thread's shard becomes empty or non-empty, so
+    // it pays off when each thread keeps at least one handle of its own.
+    // Costs Shards cache lines per object and has no weak references.
+    //
+    // ------------------------------------------------------------------
+    template <typename T, unsigned int Shards = 16>
+    class sharded_shared_ptr
+    {
+      public:
+        sharded_shared_ptr();
+        sharded_shared_ptr(const sharded_shared_ptr<T, Shards>& otherShared);
+        sharded_shared_ptr(sharded_shared_ptr<T, Shards>&& otherShared) noexcept;
+
+        // Destructor
+        ~sharded_shared_ptr();
+
+        sharded_shared_ptr<T, Shards>& operator=(const sharded_shared_ptr<T, Shards>& otherShared);
+        sharded_shared_ptr<T, Shards>& operator=(sharded_shared_ptr<T, Shards>&& otherShared) noexcept;
+
+        T* get() const { return (block) ? block->get() : nullptr; }
+        T* operator->() const { return get(); }
+        T& operator*() const;
+
+        // Sum of all shards
+        unsigned int use_count() const { return (block) ? block->use_count() : 0; }
+
+      private:
+        template <typename U, unsigned int S, typename... Args>
+        friend sharded_shared_ptr<U, S> make_sharded_shared(Args&&... args);
+
+        using block_type = detail::sharded_block<T, Shards>;
+
+        // Adopts a block that already holds one reference in shard
+        sharded_shared_ptr(block_type* adoptBlock, unsigned int shard);
+
+        static unsigned int currentShard() { return detail::thread_index() % Shards; }
+        void release();
+
+        block_type* block;
+        // The shard this handle is counted in, which may not be the current thread's
+        unsigned int shard;
+    };
+
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>::sharded_shared_ptr() :
+        block(nullptr), shard(0)
+    {
+    }
+
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>::sharded_shared_ptr(block_type* adoptBlock, unsigned int shard) :
+        block(adoptBlock), shard(shard)
+    {
+    }
+
+    // Copy constructor: the new handle counts in the copying thread's shard
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>::sharded_shared_ptr(const sharded_shared_ptr<T, Shards>& otherShared) :
+        block(otherShared.block), shard(currentShard())
+    {
+        if (block)
+        {
+            block->acquire(shard);
+        }
+    }
+
+    // Move constructor
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>::sharded_shared_ptr(sharded_shared_ptr<T, Shards>&& otherShared) noexcept :
+        block(otherShared.block), shard(otherShared.shard)
+    {
+        otherShared.block = nullptr;
+    }
+
+    // Destructor
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>::~sharded_shared_ptr()
+    {
+        release();
+    }
+
+    // Copy assignment operator
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>& sharded_shared_ptr<T, Shards>::operator=(const sharded_shared_ptr<T, Shards>& otherShared)
+    {
+        if (this != &otherShared)
+        {
+            sharded_shared_ptr<T, Shards> copy(otherShared);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    // Move assignment operator
+    template <typename T, unsigned int Shards>
+    sharded_shared_ptr<T, Shards>& sharded_shared_ptr<T, Shards>::operator=(sharded_shared_ptr<T, Shards>&& otherShared) noexcept
+    {
+        if (this != &otherShared)
+        {
+            release();
+            block = otherShared.block;
+            shard = otherShared.shard;
+            otherShared.block = nullptr;
+        }
+        return *this;
+    }
+
+    template <typename T, unsigned int Shards>
+    T& sharded_shared_ptr<T, Shards>::operator*() const
+    {
+        if (!block)
+        {
+            throw std::runtime_error("Attempting to dereference a null sharded_shared_ptr.");
+        }
+        return *block->get();
+    }
+
+    template <typename T, unsigned int Shards>
+    void sharded_shared_ptr<T, Shards>::release()
+    {
+        if (block && block->release(shard))
+        {
+            delete block;
+        }
+        block = nullptr;
+    }
+
+    template <typename T, unsigned int Shards = 16, typename... Args>
+    sharded_shared_ptr<T, Shards> make_sharded_shared(Args&&... args)
+    {
+        unsigned int shard = sharded_shared_ptr<T, Shards>::currentShard();
+        auto newBlock = new detail::sharded_block<T, Shards>(shard, std::forward<Args>(args)...);
+        return sharded_shared_ptr<T, Shards>(newBlock, shard);
+    }
+} // namespace usu
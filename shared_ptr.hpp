@@ -1,268 +1,1012 @@
 #pragma once
+#include "access_policy.hpp"
+#include "allocator.hpp"
+#include "instrumentation.hpp"
+#include "ref_counter.hpp"
+#include "relocation.hpp"
+#include "sampling.hpp"
+#include "unique_ptr.hpp"
+
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <source_location>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
-// Standard Shared Pointer
 namespace usu
 {
+    namespace detail
+    {
+        // Bookkeeping shared by every owner of a managed object. The strong count
+        // keeps the object alive; the weak count keeps the block itself alive and
+        // includes one extra reference held on behalf of all strong owners.
+        // Derived blocks decide how the object is destroyed and how their memory
+        // is released.
+        template <typename Counter>
+        class control_block
+        {
+          public:
+            control_block() :
+                refCount(1), weakCount(1)
+            {
+            }
+
+            void increment() { Counter::increment(refCount); }
+            // Returns false if the object has already been destroyed
+            bool try_increment() { return Counter::increment_if_nonzero(refCount); }
+            unsigned int use_count() const { return Counter::load(refCount); }
+            // True when the caller holds the only strong reference, ordered after
+            // the releases of every other owner so their reads are finished
+            bool unique() const { return Counter::load_acquire(refCount) == 1; }
+
+            // Records a new object of type T with the instrumentation, if it is built in
+            template <typename T>
+            void track() { lifetime.template start<T>(); }
+
+            // Drops a strong reference; the last one destroys the object
+            void release()
+            {
+                if (Counter::decrement(refCount))
+                {
+                    lifetime.finish();
+                    forget_sample(this);
+                    destroy_object();
+                    release_weak();
+                }
+            }
+
+            void increment_weak() { Counter::increment(weakCount); }
+
+            // Drops a weak reference; the last one frees the block
+            void release_weak()
+            {
+                if (Counter::decrement(weakCount))
+                {
+                    deallocate();
+                }
+            }
+
+          protected:
+            virtual ~control_block() = default;
+
+            // Destroys the managed object
+            virtual void destroy_object() noexcept = 0;
+            // Frees the block (and the object storage, if it is inline)
+            virtual void deallocate() noexcept = 0;
+
+          private:
+            typename Counter::type refCount;
+            typename Counter::type weakCount;
+            // Empty unless USU_INSTRUMENTATION is defined
+            [[no_unique_address]] lifetime_stamp lifetime;
+        };
+
+        // Block for an object the caller allocated itself (two allocations). The
+        // deleter and the allocator live inside the block, so a stateless one
+        // costs nothing and a small stateful one needs no allocation of its own.
+        // The block comes from Alloc, the slab pool unless the caller gives one,
+        // so by default only the object hits global new.
+        template <typename T, typename Counter, typename Deleter, typename Alloc>
+        class pointer_block : public control_block<Counter>
+        {
+          public:
+            pointer_block(T* ptr, const Deleter& deleter, const Alloc& alloc) :
+                rawPointer(ptr), deleter(deleter), alloc(alloc)
+            {
+            }
+
+          protected:
+            void destroy_object() noexcept override { deleter(rawPointer); }
+            void deallocate() noexcept override
+            {
+                using block_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<pointer_block>;
+                block_alloc blockAlloc(alloc);
+                this->~pointer_block();
+                std::allocator_traits<block_alloc>::deallocate(blockAlloc, this, 1);
+            }
+
+          private:
+            T* rawPointer;
+            [[no_unique_address]] Deleter deleter;
+            [[no_unique_address]] Alloc alloc;
+        };
+
+        // Builds the block that will own ptr, or a null block for a null ptr. If
+        // the block cannot be allocated the deleter still runs, so ptr never leaks.
+        template <typename Counter, typename T, typename Deleter, typename Alloc>
+        control_block<Counter>* adopt_pointer(T* ptr, Deleter& deleter, const Alloc& alloc)
+        {
+            if (!ptr)
+            {
+                return nullptr;
+            }
+            try
+            {
+                return allocate_block<pointer_block<T, Counter, Deleter, Alloc>>(alloc, ptr, deleter, alloc);
+            }
+            catch (...)
+            {
+                deleter(ptr);
+                throw;
+            }
+        }
+
+        // Block that holds the object itself, so make_shared needs one allocation
+        // and the count shares a cache line with the start of the object. The
+        // object lives in a union so it can be destroyed while weak references
+        // keep the storage alive. The block's memory comes from Alloc, rebound
+        // to the block type.
+        template <typename T, typename Counter, typename Alloc>
+        class inplace_block : public control_block<Counter>
+        {
+          public:
+            // The object is built through the allocator, as allocate_shared requires
+            template <typename... Args>
+            explicit inplace_block(const Alloc& alloc, Args&&... args) :
+                alloc(alloc)
+            {
+                std::allocator_traits<Alloc>::construct(this->alloc, &object, std::forward<Args>(args)...);
+            }
+
+            T* get() { return &object; }
+
+          protected:
+            ~inplace_block() override {}
+
+            void destroy_object() noexcept override { std::allocator_traits<Alloc>::destroy(alloc, &object); }
+            void deallocate() noexcept override
+            {
+                using block_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<inplace_block>;
+                block_alloc blockAlloc(alloc);
+                this->~inplace_block();
+                std::allocator_traits<block_alloc>::deallocate(blockAlloc, this, 1);
+            }
+
+          private:
+            [[no_unique_address]] Alloc alloc;
+            union
+            {
+                T object;
+            };
+        };
+
+        template <typename T, unsigned int N, typename Counter>
+        class inplace_array_block : public control_block<Counter>
+        {
+          public:
+            inplace_array_block() :
+                elements()
+            {
+            }
+
+            T* get() { return elements; }
+
+          protected:
+            ~inplace_array_block() override {}
+
+            void destroy_object() noexcept override { destroy_elements(elements, N); }
+            void deallocate() noexcept override
+            {
+                this->~inplace_array_block();
+                pool_allocator<inplace_array_block>().deallocate(this, 1);
+            }
+
+          private:
+            union
+            {
+                T elements[N];
+            };
+        };
+
+        // Block followed by a run-time number of elements in the same allocation.
+        // The elements start at the first multiple of their alignment past the
+        // block, so 32- or 64-byte aligned storage costs at most one alignment of
+        // padding. Small arrays still come from the slab pool.
+        template <typename T, typename Counter>
+        class dynamic_array_block : public control_block<Counter>
+        {
+          public:
+            // Allocates the block and count elements, value-initialized unless Overwrite is set
+            template <bool Overwrite>
+            static dynamic_array_block* create(std::size_t count, std::size_t alignment);
+
+            T* get() { return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + elementOffset(alignment)); }
+
+          protected:
+            ~dynamic_array_block() override {}
+
+            void destroy_object() noexcept override { destroy_elements(get(), count); }
+            void deallocate() noexcept override
+            {
+                std::size_t bytes = elementOffset(alignment) + count * sizeof(T);
+                std::size_t blockAlignment = alignment;
+                this->~dynamic_array_block();
+                pool_deallocate(this, bytes, blockAlignment);
+            }
+
+          private:
+            dynamic_array_block(std::size_t count, std::size_t alignment) :
+                count(count), alignment(alignment)
+            {
+            }
+
+            static std::size_t elementOffset(std::size_t alignment) { return (sizeof(dynamic_array_block) + alignment - 1) / alignment * alignment; }
+
+            std::size_t count;
+            std::size_t alignment;
+        };
+
+        template <typename T, typename Counter>
+        template <bool Overwrite>
+        dynamic_array_block<T, Counter>* dynamic_array_block<T, Counter>::create(std::size_t count, std::size_t alignment)
+        {
+            alignment = std::max(array_alignment<T>(alignment), alignof(dynamic_array_block));
+            std::size_t bytes = array_bytes<T>(count, elementOffset(alignment));
+            void* memory = pool_allocate(bytes, alignment);
+            try
+            {
+                construct_elements<T, Overwrite>(reinterpret_cast<T*>(static_cast<char*>(memory) + elementOffset(alignment)), count);
+            }
+            catch (...)
+            {
+                pool_deallocate(memory, bytes, alignment);
+                throw;
+            }
+            return ::new (memory) dynamic_array_block(count, alignment);
+        }
+    } // namespace detail
+
+    template <typename T, typename Counter>
+    class weak_ptr;
+
     template <typename T>
+    class atomic_shared_ptr;
+
+    template <typename T, typename Counter>
+    class cow_ptr;
+
+    template <typename T, typename Counter>
+    class shared_ptr;
+
+    namespace detail
+    {
+        // Wraps a new block that holds the object and one strong reference
+        template <typename T, typename Counter, typename Block>
+        shared_ptr<T, Counter> adopt_inplace(Block* newBlock);
+        // The same for a block that holds size array elements
+        template <typename T, typename Counter, typename Block>
+        shared_ptr<T[], Counter> adopt_array(Block* newBlock, std::size_t size);
+    } // namespace detail
+
+    // Standard Shared Pointer. Counter selects how the reference count is
+    // updated; the default is safe to share between threads.
+    template <typename T, typename Counter = thread_safe_counter>
     class shared_ptr
     {
       public:
         explicit shared_ptr(T* ptr = nullptr);
-        shared_ptr(shared_ptr<T>& otherShared);
-        shared_ptr(shared_ptr<T>&& otherShared);
+        // Takes ownership of ptr; the last owner calls deleter(ptr). The deleter is
+        // stored in the control block, which is allocated through alloc.
+        template <typename Deleter>
+        shared_ptr(T* ptr, Deleter deleter);
+        template <typename Deleter, typename Alloc>
+        shared_ptr(T* ptr, Deleter deleter, const Alloc& alloc);
+        shared_ptr(const shared_ptr<T, Counter>& otherShared) noexcept;
+        shared_ptr(shared_ptr<T, Counter>&& otherShared) noexcept;
+        // Aliasing constructor: shares owner's block but points at ptr, typically
+        // a member or element of the object owner manages
+        template <typename U>
+        shared_ptr(const shared_ptr<U, Counter>& owner, T* ptr);
 
         // Destructor
         ~shared_ptr();
 
         // Returns a pointer to the raw pointer
-        T* get() { return this->rawPointer; }
+        T* get() const { return this->rawPointer; }
         // Returns the reference count
-        unsigned int use_count() { return *(this->refCount); }
+        unsigned int use_count() const { return (block) ? block->use_count() : 0; }
 
-        shared_ptr<T>& operator=(const shared_ptr<T>& otherShared);
-        T* operator->() { return get(); }
+        shared_ptr<T, Counter>& operator=(const shared_ptr<T, Counter>& otherShared) noexcept;
+        shared_ptr<T, Counter>& operator=(shared_ptr<T, Counter>&& otherShared) noexcept;
+        T* operator->() const { return get(); }
         T operator*() { return *(get()); }
 
       private:
-        unsigned int* refCount;
+        template <typename U, typename C, typename Block>
+        friend shared_ptr<U, C> detail::adopt_inplace(Block* newBlock);
+        template <typename U, typename C>
+        friend class shared_ptr;
+        friend class weak_ptr<T, Counter>;
+        friend class atomic_shared_ptr<T>;
+        friend class cow_ptr<T, Counter>;
+
+        // Adopts a block that already holds one reference
+        shared_ptr(detail::control_block<Counter>* adoptBlock, T* ptr);
+
+        void enableSharedFromThis();
+        void release();
+
+        detail::control_block<Counter>* block;
         T* rawPointer;
     };
 
-    template <typename T>
-    shared_ptr<T>::shared_ptr(T* ptr) :
-        refCount(nullptr), rawPointer(ptr)
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>::shared_ptr(T* ptr) :
+        shared_ptr(ptr, default_delete<T>(), pool_allocator<T>())
+    {
+    }
+
+    template <typename T, typename Counter>
+    template <typename Deleter>
+    shared_ptr<T, Counter>::shared_ptr(T* ptr, Deleter deleter) :
+        shared_ptr(ptr, std::move(deleter), pool_allocator<T>())
+    {
+    }
+
+    template <typename T, typename Counter>
+    template <typename Deleter, typename Alloc>
+    shared_ptr<T, Counter>::shared_ptr(T* ptr, Deleter deleter, const Alloc& alloc) :
+        block(detail::adopt_pointer<Counter>(ptr, deleter, alloc)), rawPointer(ptr)
+    {
+        if (block)
+        {
+            block->template track<T>();
+            enableSharedFromThis();
+        }
+    }
+
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>::shared_ptr(detail::control_block<Counter>* adoptBlock, T* ptr) :
+        block(adoptBlock), rawPointer(ptr)
     {
-        rawPointer = ptr;
-        refCount = new unsigned int(1);
     }
 
     // Copy constructor
-    template <typename T>
-    shared_ptr<T>::shared_ptr(shared_ptr<T>& otherShared)
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>::shared_ptr(const shared_ptr<T, Counter>& otherShared) noexcept :
+        block(otherShared.block), rawPointer(otherShared.rawPointer)
     {
-        refCount = otherShared.refCount;
-        rawPointer = otherShared.rawPointer;
-        if (refCount)
+        if (block)
         {
-            (*refCount)++;
+            block->increment();
+            detail::instrument<T>::copied();
         }
     }
 
     // Move constructor
-    template <typename T>
-    shared_ptr<T>::shared_ptr(shared_ptr<T>&& otherShared)
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>::shared_ptr(shared_ptr<T, Counter>&& otherShared) noexcept :
+        block(otherShared.block), rawPointer(otherShared.rawPointer)
     {
-        refCount = otherShared.refCount;
-        rawPointer = otherShared.rawPointer;
+        if (block)
+        {
+            detail::instrument<T>::moved();
+        }
         otherShared.rawPointer = nullptr;
-        otherShared.refCount = nullptr;
+        otherShared.block = nullptr;
+    }
+
+    // Aliasing constructor
+    template <typename T, typename Counter>
+    template <typename U>
+    shared_ptr<T, Counter>::shared_ptr(const shared_ptr<U, Counter>& owner, T* ptr) :
+        block(owner.block), rawPointer(ptr)
+    {
+        if (block)
+        {
+            block->increment();
+            detail::instrument<T>::copied();
+        }
     }
 
     // Destructor
-    template <typename T>
-    shared_ptr<T>::~shared_ptr()
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>::~shared_ptr()
     {
-        if (refCount)
+        release();
+    }
+
+    // Copy assignment operator. The new reference is taken before the old one is
+    // dropped, in case otherShared lives inside the object being released.
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>& shared_ptr<T, Counter>::operator=(const shared_ptr<T, Counter>& otherShared) noexcept
+    {
+        // Avoid self-assignment
+        if (this != &otherShared)
         {
-            (*refCount)--;
-            if (*refCount == 0)
+            if (otherShared.block)
             {
-                delete rawPointer;
-                delete refCount;
+                otherShared.block->increment();
+                detail::instrument<T>::copied();
+            }
+            auto oldBlock = block;
+            block = otherShared.block;
+            rawPointer = otherShared.rawPointer;
+            // Released last, as otherShared may not outlive the old object
+            if (oldBlock)
+            {
+                oldBlock->release();
             }
         }
+        return *this;
     }
 
-    template <typename T>
-    shared_ptr<T>& shared_ptr<T>::operator=(const shared_ptr<T>& otherShared)
+    // Move assignment operator
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter>& shared_ptr<T, Counter>::operator=(shared_ptr<T, Counter>&& otherShared) noexcept
     {
-        // Avoid self-assignment
         if (this != &otherShared)
         {
-            // Decrement the refCount of the current object
-            if (refCount)
+            if (otherShared.block)
             {
-                (*refCount)--;
-                if (*refCount == 0)
-                {
-                    delete rawPointer;
-                    delete refCount;
-                }
+                detail::instrument<T>::moved();
             }
+            auto oldBlock = block;
+            block = otherShared.block;
             rawPointer = otherShared.rawPointer;
-            refCount = otherShared.refCount;
+            otherShared.block = nullptr;
+            otherShared.rawPointer = nullptr;
+            // Released last, in case otherShared lived inside the old object
+            if (oldBlock)
+            {
+                oldBlock->release();
+            }
+        }
+        return *this;
+    }
 
-            if (refCount)
+    // Points an enable_shared_from_this base at the block that now owns the object
+    template <typename T, typename Counter>
+    void shared_ptr<T, Counter>::enableSharedFromThis()
+    {
+        if constexpr (requires { typename T::shared_from_this_base; })
+        {
+            using Base = typename T::shared_from_this_base;
+            static_assert(std::is_same_v<typename Base::counter_type, Counter>,
+                          "enable_shared_from_this and shared_ptr must use the same Counter");
+            Base& base = *rawPointer;
+            if (base.weakThis.expired())
             {
-                (*refCount)++;
+                base.weakThis = weak_ptr<typename Base::element_type, Counter>(block, rawPointer);
             }
         }
+    }
+
+    // Drops this owner's reference, destroying the object if it was the last
+    template <typename T, typename Counter>
+    void shared_ptr<T, Counter>::release()
+    {
+        if (block)
+        {
+            block->release();
+        }
+    }
+
+    template <typename T, typename Counter, typename Block>
+    shared_ptr<T, Counter> detail::adopt_inplace(Block* newBlock)
+    {
+        newBlock->template track<T>();
+        shared_ptr<T, Counter> shared(newBlock, newBlock->get());
+        shared.enableSharedFromThis();
+        return shared;
+    }
+
+    // Allocates the control block and the object together from a user allocator
+    template <typename T, typename Counter = thread_safe_counter, typename Alloc, typename... Args>
+    shared_ptr<T, Counter> allocate_shared(const Alloc& alloc, Args&&... args)
+    {
+        using object_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        object_alloc objectAlloc(alloc);
+        auto newBlock = detail::allocate_block<detail::inplace_block<T, Counter, object_alloc>>(objectAlloc, objectAlloc, std::forward<Args>(args)...);
+        return detail::adopt_inplace<T, Counter>(newBlock);
+    }
+
+    namespace detail
+    {
+        // How the sampler reads the strong count of a sampled block
+        template <typename Counter>
+        unsigned int sampled_use_count(const void* key)
+        {
+            return static_cast<const control_block<Counter>*>(key)->use_count();
+        }
+
+        // make_shared_at's call, with the type and size folded in to keep the call short
+        template <typename T, typename Counter, std::size_t Bytes>
+        USU_COLD void sample_block(const control_block<Counter>* newBlock, std::source_location site) noexcept
+        {
+            sample_allocation(newBlock, site, typeid(T).name(), Bytes, &sampled_use_count<Counter>);
+        }
+    } // namespace detail
+
+    // Allocates the control block and the object together from the slab pool.
+    // When the sampler takes it, the object is filed under site; pass
+    // std::source_location::current() to name the line that made it.
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+    shared_ptr<T, Counter> make_shared_at(std::source_location site, Args&&... args)
+    {
+        using block = detail::inplace_block<T, Counter, pool_allocator<T>>;
+        pool_allocator<T> alloc;
+        auto newBlock = detail::allocate_block<block>(alloc, alloc, std::forward<Args>(args)...);
+        if (detail::sampling_on()) [[unlikely]]
+        {
+            detail::sample_block<T, Counter, sizeof(block)>(newBlock, site);
+        }
+        return detail::adopt_inplace<T, Counter>(newBlock);
+    }
+
+    // Allocates the control block and the object together from the slab pool.
+    // Sampled objects are filed under an unknown site, by type.
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+        requires(!detail::leads_with_resource<Args...>)
+    shared_ptr<T, Counter> make_shared(Args&&... args)
+    {
+        return make_shared_at<T, Counter>(std::source_location(), std::forward<Args>(args)...);
+    }
+
+    // Allocates the control block and the object together from a memory resource,
+    // which gets the memory back when the last weak or strong owner lets go
+    template <typename T, typename Counter = thread_safe_counter, typename... Args>
+    shared_ptr<T, Counter> make_shared(std::pmr::memory_resource* resource, Args&&... args)
+    {
+        return allocate_shared<T, Counter>(std::pmr::polymorphic_allocator<T>(resource), std::forward<Args>(args)...);
+    }
+
+    // Non-owning reference to an object managed by shared_ptr. It keeps the
+    // control block alive, but not the object.
+    template <typename T, typename Counter = thread_safe_counter>
+    class weak_ptr
+    {
+      public:
+        weak_ptr();
+        weak_ptr(const shared_ptr<T, Counter>& shared);
+        weak_ptr(const weak_ptr<T, Counter>& otherWeak);
+        weak_ptr(weak_ptr<T, Counter>&& otherWeak) noexcept;
+
+        // Destructor
+        ~weak_ptr();
+
+        weak_ptr<T, Counter>& operator=(const weak_ptr<T, Counter>& otherWeak);
+        weak_ptr<T, Counter>& operator=(weak_ptr<T, Counter>&& otherWeak) noexcept;
+
+        // Returns an owning pointer, or an empty one if the object is gone
+        shared_ptr<T, Counter> lock() const;
+        bool expired() const { return use_count() == 0; }
+        unsigned int use_count() const { return (block) ? block->use_count() : 0; }
+        void reset();
+
+      private:
+        template <typename U, typename C>
+        friend class shared_ptr;
+
+        // Adds a weak reference to a block owned by a shared_ptr of a related type
+        weak_ptr(detail::control_block<Counter>* sharedBlock, T* ptr);
+
+        detail::control_block<Counter>* block;
+        T* rawPointer;
+    };
+
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>::weak_ptr() :
+        block(nullptr), rawPointer(nullptr)
+    {
+    }
+
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>::weak_ptr(const shared_ptr<T, Counter>& shared) :
+        block(shared.block), rawPointer(shared.rawPointer)
+    {
+        if (block)
+        {
+            block->increment_weak();
+        }
+    }
+
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>::weak_ptr(detail::control_block<Counter>* sharedBlock, T* ptr) :
+        block(sharedBlock), rawPointer(ptr)
+    {
+        block->increment_weak();
+    }
+
+    // Copy constructor
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>::weak_ptr(const weak_ptr<T, Counter>& otherWeak) :
+        block(otherWeak.block), rawPointer(otherWeak.rawPointer)
+    {
+        if (block)
+        {
+            block->increment_weak();
+        }
+    }
+
+    // Move constructor
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>::weak_ptr(weak_ptr<T, Counter>&& otherWeak) noexcept :
+        block(otherWeak.block), rawPointer(otherWeak.rawPointer)
+    {
+        otherWeak.block = nullptr;
+        otherWeak.rawPointer = nullptr;
+    }
+
+    // Destructor
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>::~weak_ptr()
+    {
+        reset();
+    }
+
+    // Copy assignment operator
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>& weak_ptr<T, Counter>::operator=(const weak_ptr<T, Counter>& otherWeak)
+    {
+        if (this != &otherWeak)
+        {
+            if (otherWeak.block)
+            {
+                otherWeak.block->increment_weak();
+            }
+            reset();
+            block = otherWeak.block;
+            rawPointer = otherWeak.rawPointer;
+        }
         return *this;
     }
 
-    template <typename T, typename... Args>
-    shared_ptr<T> make_shared(Args&&... args)
+    // Move assignment operator
+    template <typename T, typename Counter>
+    weak_ptr<T, Counter>& weak_ptr<T, Counter>::operator=(weak_ptr<T, Counter>&& otherWeak) noexcept
+    {
+        if (this != &otherWeak)
+        {
+            reset();
+            block = otherWeak.block;
+            rawPointer = otherWeak.rawPointer;
+            otherWeak.block = nullptr;
+            otherWeak.rawPointer = nullptr;
+        }
+        return *this;
+    }
+
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter> weak_ptr<T, Counter>::lock() const
+    {
+        if (block && block->try_increment())
+        {
+            detail::instrument<T>::copied();
+            return shared_ptr<T, Counter>(block, rawPointer);
+        }
+        return shared_ptr<T, Counter>();
+    }
+
+    template <typename T, typename Counter>
+    void weak_ptr<T, Counter>::reset()
+    {
+        if (block)
+        {
+            block->release_weak();
+        }
+        block = nullptr;
+        rawPointer = nullptr;
+    }
+
+    // Base class that lets an object managed by shared_ptr hand out more owners
+    // of itself. The weak reference is filled in when the first shared_ptr takes
+    // ownership, so no extra allocation is needed.
+    template <typename T, typename Counter = thread_safe_counter>
+    class enable_shared_from_this
+    {
+      public:
+        using shared_from_this_base = enable_shared_from_this<T, Counter>;
+        using element_type = T;
+        using counter_type = Counter;
+
+        shared_ptr<T, Counter> shared_from_this();
+        weak_ptr<T, Counter> weak_from_this() const { return weakThis; }
+
+      protected:
+        enable_shared_from_this() = default;
+        // Copies of the object get their own owners, so the reference is never copied
+        enable_shared_from_this(const enable_shared_from_this&) {}
+        enable_shared_from_this& operator=(const enable_shared_from_this&) { return *this; }
+        ~enable_shared_from_this() = default;
+
+      private:
+        template <typename U, typename C>
+        friend class shared_ptr;
+
+        weak_ptr<T, Counter> weakThis;
+    };
+
+    template <typename T, typename Counter>
+    shared_ptr<T, Counter> enable_shared_from_this<T, Counter>::shared_from_this()
     {
-        return shared_ptr<T>(new T(std::forward<Args>(args)...));
+        auto shared = weakThis.lock();
+        if (!shared.get())
+        {
+            throw std::runtime_error("shared_from_this called on an object not owned by a shared_ptr.");
+        }
+        return shared;
     }
 
     // Array shared pointer
 
-    template <typename T>
-    class shared_ptr<T[]>
+    template <typename T, typename Counter>
+    class shared_ptr<T[], Counter>
     {
       public:
         explicit shared_ptr(T* ptr = nullptr, size_t size = 0);
-        shared_ptr(const shared_ptr<T[]>& otherShared);
-        shared_ptr(shared_ptr<T[]>&& otherShared) noexcept;
+        // Takes ownership of size elements at ptr; the last owner calls deleter(ptr)
+        template <typename Deleter>
+        shared_ptr(T* ptr, size_t size, Deleter deleter);
+        template <typename Deleter, typename Alloc>
+        shared_ptr(T* ptr, size_t size, Deleter deleter, const Alloc& alloc);
+        shared_ptr(const shared_ptr<T[], Counter>& otherShared) noexcept;
+        shared_ptr(shared_ptr<T[], Counter>&& otherShared) noexcept;
+        // Aliasing constructor: a view of size elements at ptr that keeps owner's
+        // object alive
+        template <typename U>
+        shared_ptr(const shared_ptr<U, Counter>& owner, T* ptr, size_t size);
 
         // Destructor
         ~shared_ptr();
 
-        shared_ptr<T[]>& operator=(const shared_ptr<T[]>& otherShared);
-        shared_ptr<T[]>& operator=(shared_ptr<T[]>&& otherShared) noexcept;
+        shared_ptr<T[], Counter>& operator=(const shared_ptr<T[], Counter>& otherShared) noexcept;
+        shared_ptr<T[], Counter>& operator=(shared_ptr<T[], Counter>&& otherShared) noexcept;
+
+        // Checked as the build's default_access says
+        T& operator[](size_t index) const { return element<default_access>(index); }
+        // Element access with the checks chosen per call, for hot loops
+        template <typename Access>
+        T& element(size_t index) const;
 
-        T& operator[](size_t index) const;
+        // Shared view of length elements starting at offset. It costs one count
+        // increment and keeps the whole array alive.
+        shared_ptr<T[], Counter> slice(size_t offset, size_t length) const;
 
+        // First element, for handing the buffer to code that works on raw pointers
+        T* get() const { return rawPointer; }
         size_t size() const { return this->arraySize; }
+        // The elements as a span, which does not keep them alive on its own
+        std::span<T> span() const { return std::span<T>(rawPointer, arraySize); }
 
-        unsigned int use_count() const { return (refCount) ? *refCount : 0; }
+        unsigned int use_count() const { return (block) ? block->use_count() : 0; }
 
       private:
-        unsigned int* refCount;
+        template <typename U, typename C>
+        friend class shared_ptr;
+        template <typename U, typename C, typename Block>
+        friend shared_ptr<U[], C> detail::adopt_array(Block* newBlock, std::size_t size);
+
+        // Adopts a block that already holds one reference
+        shared_ptr(detail::control_block<Counter>* adoptBlock, T* ptr, size_t size);
+
+        void release();
+
+        detail::control_block<Counter>* block;
         T* rawPointer;
         size_t arraySize;
     };
 
     // Constructor
-    template <typename T>
-    shared_ptr<T[]>::shared_ptr(T* ptr, size_t size) :
-        refCount(nullptr), rawPointer(ptr), arraySize(size)
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>::shared_ptr(T* ptr, size_t size) :
+        shared_ptr(ptr, size, default_delete<T[]>(), pool_allocator<T>())
+    {
+    }
+
+    template <typename T, typename Counter>
+    template <typename Deleter>
+    shared_ptr<T[], Counter>::shared_ptr(T* ptr, size_t size, Deleter deleter) :
+        shared_ptr(ptr, size, std::move(deleter), pool_allocator<T>())
     {
-        if (ptr)
+    }
+
+    template <typename T, typename Counter>
+    template <typename Deleter, typename Alloc>
+    shared_ptr<T[], Counter>::shared_ptr(T* ptr, size_t size, Deleter deleter, const Alloc& alloc) :
+        block(detail::adopt_pointer<Counter>(ptr, deleter, alloc)), rawPointer(ptr), arraySize(size)
+    {
+        if (block)
         {
-            refCount = new unsigned int(1);
+            block->template track<T[]>();
         }
     }
 
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>::shared_ptr(detail::control_block<Counter>* adoptBlock, T* ptr, size_t size) :
+        block(adoptBlock), rawPointer(ptr), arraySize(size)
+    {
+    }
+
     // Copy constructor
-    template <typename T>
-    shared_ptr<T[]>::shared_ptr(const shared_ptr<T[]>& otherShared) :
-        refCount(otherShared.refCount), rawPointer(otherShared.rawPointer), arraySize(otherShared.arraySize)
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>::shared_ptr(const shared_ptr<T[], Counter>& otherShared) noexcept :
+        block(otherShared.block), rawPointer(otherShared.rawPointer), arraySize(otherShared.arraySize)
     {
-        if (refCount)
+        if (block)
         {
-            (*refCount)++;
+            block->increment();
+            detail::instrument<T[]>::copied();
         }
     }
 
     // Move constructor
-    template <typename T>
-    shared_ptr<T[]>::shared_ptr(shared_ptr<T[]>&& otherShared) noexcept
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>::shared_ptr(shared_ptr<T[], Counter>&& otherShared) noexcept
         :
-        refCount(otherShared.refCount),
+        block(otherShared.block),
         rawPointer(otherShared.rawPointer), arraySize(otherShared.arraySize)
     {
-        otherShared.refCount = nullptr;
+        if (block)
+        {
+            detail::instrument<T[]>::moved();
+        }
+        otherShared.block = nullptr;
         otherShared.rawPointer = nullptr;
         otherShared.arraySize = 0;
     }
 
-    // Destructor
-    template <typename T>
-    shared_ptr<T[]>::~shared_ptr()
+    // Aliasing constructor
+    template <typename T, typename Counter>
+    template <typename U>
+    shared_ptr<T[], Counter>::shared_ptr(const shared_ptr<U, Counter>& owner, T* ptr, size_t size) :
+        block(owner.block), rawPointer(ptr), arraySize(size)
     {
-        if (refCount)
+        if (block)
         {
-            (*refCount)--;
-            if (*refCount == 0)
-            {
-                delete[] rawPointer;
-                delete refCount;
-            }
+            block->increment();
+            detail::instrument<T[]>::copied();
         }
     }
 
+    // Destructor
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>::~shared_ptr()
+    {
+        release();
+    }
+
     // Copy assignment operator
-    template <typename T>
-    shared_ptr<T[]>& shared_ptr<T[]>::operator=(const shared_ptr<T[]>& otherShared)
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>& shared_ptr<T[], Counter>::operator=(const shared_ptr<T[], Counter>& otherShared) noexcept
     {
         if (this != &otherShared)
         {
-            // Decrement current object
-            if (refCount)
+            // Increment the count first, as the single-object version does
+            if (otherShared.block)
             {
-                (*refCount)--;
-                if (*refCount == 0)
-                {
-                    delete[] rawPointer;
-                    delete refCount;
-                }
+                otherShared.block->increment();
+                detail::instrument<T[]>::copied();
             }
 
             // Copy data from otherShared
+            auto oldBlock = block;
             rawPointer = otherShared.rawPointer;
-            refCount = otherShared.refCount;
+            block = otherShared.block;
             arraySize = otherShared.arraySize;
 
-            // Increment the refCoun
-            if (refCount)
+            // Released last, as otherShared may not outlive the old array
+            if (oldBlock)
             {
-                (*refCount)++;
+                oldBlock->release();
             }
         }
         return *this;
     }
 
     // Move assignment operator
-    template <typename T>
-    shared_ptr<T[]>& shared_ptr<T[]>::operator=(shared_ptr<T[]>&& otherShared) noexcept
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter>& shared_ptr<T[], Counter>::operator=(shared_ptr<T[], Counter>&& otherShared) noexcept
     {
         if (this != &otherShared)
         {
-            // Decrement current object's refCount
-            if (refCount)
+            if (otherShared.block)
             {
-                (*refCount)--;
-                if (*refCount == 0)
-                {
-                    delete[] rawPointer;
-                    delete refCount;
-                }
+                detail::instrument<T[]>::moved();
             }
-
             // Transfer ownership from otherShared
+            auto oldBlock = block;
             rawPointer = otherShared.rawPointer;
-            refCount = otherShared.refCount;
+            block = otherShared.block;
             arraySize = otherShared.arraySize;
 
             otherShared.rawPointer = nullptr;
-            otherShared.refCount = nullptr;
+            otherShared.block = nullptr;
             otherShared.arraySize = 0;
+
+            // Released last, in case otherShared lived inside the old array
+            if (oldBlock)
+            {
+                oldBlock->release();
+            }
         }
         return *this;
     }
 
-    // Overloaded [] operator
-    template <typename T>
-    T& shared_ptr<T[]>::operator[](size_t index) const
+    // Drops this owner's reference, destroying the array if it was the last
+    template <typename T, typename Counter>
+    void shared_ptr<T[], Counter>::release()
     {
-        if (!rawPointer)
+        if (block)
         {
-            throw std::runtime_error("Attempting to access elements of a null shared_ptr.");
+            block->release();
         }
-        if (index >= arraySize)
+    }
+
+    template <typename T, typename Counter>
+    template <typename Access>
+    T& shared_ptr<T[], Counter>::element(size_t index) const
+    {
+        Access::template require<std::runtime_error>(rawPointer != nullptr, "Attempting to access elements of a null shared_ptr.");
+        Access::template require<std::out_of_range>(index < arraySize, "Index out of bounds.");
+        return rawPointer[index];
+    }
+
+    template <typename T, typename Counter>
+    shared_ptr<T[], Counter> shared_ptr<T[], Counter>::slice(size_t offset, size_t length) const
+    {
+        if (offset > arraySize || length > arraySize - offset)
         {
-            throw std::out_of_range("Index out of bounds.");
+            throw std::out_of_range("Slice out of bounds.");
         }
-        return rawPointer[index];
+        return shared_ptr<T[], Counter>(*this, rawPointer + offset, length);
+    }
+
+    template <typename T, typename Counter, typename Block>
+    shared_ptr<T[], Counter> detail::adopt_array(Block* newBlock, std::size_t size)
+    {
+        newBlock->template track<T[]>();
+        return shared_ptr<T[], Counter>(newBlock, newBlock->get(), size);
+    }
+
+    // Allocates the control block and the elements together
+    template <typename T, unsigned int N, typename Counter = thread_safe_counter>
+    shared_ptr<T[], Counter> make_shared_array()
+    {
+        auto newBlock = detail::allocate_block<detail::inplace_array_block<T, N, Counter>>(pool_allocator<T>());
+        return detail::adopt_array<T, Counter>(newBlock, N);
+    }
+
+    // Array whose length is only known at run time, with value-initialized
+    // elements starting on an alignment-byte boundary
+    template <typename T, typename Counter = thread_safe_counter>
+    shared_ptr<T[], Counter> make_shared_array(std::size_t size, std::size_t alignment = alignof(T))
+    {
+        auto newBlock = detail::dynamic_array_block<T, Counter>::template create<false>(size, alignment);
+        return detail::adopt_array<T, Counter>(newBlock, size);
     }
 
-    template <typename T, unsigned int N>
-    shared_ptr<T[]> make_shared_array()
+    // Like make_shared_array, but trivial elements are left uninitialized, for
+    // buffers that are about to be overwritten anyway
+    template <typename A, typename Counter = thread_safe_counter>
+        requires std::is_unbounded_array_v<A>
+    shared_ptr<A, Counter> make_shared_for_overwrite(std::size_t size, std::size_t alignment = alignof(std::remove_extent_t<A>))
     {
-        return shared_ptr<T[]>(new T[N], N);
+        using T = std::remove_extent_t<A>;
+        auto newBlock = detail::dynamic_array_block<T, Counter>::template create<true>(size, alignment);
+        return detail::adopt_array<T, Counter>(newBlock, size);
     }
 
+    // Shared pointer for objects that are only ever owned from one thread. Copies
+    // and destruction use plain increments instead of atomic read-modify-writes.
+    template <typename T>
+    using local_shared_ptr = shared_ptr<T, thread_unsafe_counter>;
+
+    // Moving an owner copies two pointers and leaves a null one behind, so
+    // containers may move them with memcpy
+    template <typename T, typename Counter>
+    struct is_trivially_relocatable<shared_ptr<T, Counter>> : std::true_type
+    {
+    };
+
+    template <typename T, typename Counter>
+    struct is_trivially_relocatable<weak_ptr<T, Counter>> : std::true_type
+    {
+    };
+
 } // namespace usu
\ No newline at end of file
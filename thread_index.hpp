@@ -0,0 +1,18 @@
+#pragma once
+
+#include <atomic>
+
+namespace usu
+{
+    namespace detail
+    {
+        // Small number that identifies the calling thread, handed out in order of
+        // first use. Used to pick per-thread slots and to recognize owner threads.
+        inline unsigned int thread_index()
+        {
+            static std::atomic<unsigned int> nextIndex{ 0 };
+            thread_local unsigned int index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+    } // namespace detail
+} // namespace usu
@@ -0,0 +1,82 @@
+#pragma once
+#include "shared_ptr.hpp"
+
+#include <atomic>
+#include <vector>
+
+namespace usu
+{
+    namespace detail
+    {
+        // Takes a free record from a push-only list of per-thread records, or adds
+        // a new one. Record needs an atomic<bool> inUse (true when constructed) and
+        // a next pointer. Records are only freed along with the whole list.
+        template <typename Record>
+        Record* acquire_record(std::atomic<Record*>& head)
+        {
+            for (Record* record = head.load(std::memory_order_acquire); record; record = record->next)
+            {
+                bool expected = false;
+                if (!record->inUse.load(std::memory_order_relaxed) &&
+                    record->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                {
+                    return record;
+                }
+            }
+            auto record = new Record();
+            record->next = head.load(std::memory_order_relaxed);
+            while (!head.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+            return record;
+        }
+
+        // Finds the calling thread's record in a domain's shared state, taking one
+        // with State::acquireRecord() on first use and handing it back when the
+        // thread exits. The cache holds weak references: they pin the state's
+        // address, so a stale entry never matches a newer domain, without keeping
+        // a destroyed domain's state alive.
+        template <typename State>
+        typename State::record_type& local_record(shared_ptr<State>& state)
+        {
+            using Record = typename State::record_type;
+            struct thread_cache
+            {
+                struct entry
+                {
+                    State* key;
+                    weak_ptr<State> state;
+                    Record* record;
+                };
+
+                ~thread_cache()
+                {
+                    for (auto& cached : entries)
+                    {
+                        auto alive = cached.state.lock();
+                        if (alive.get())
+                        {
+                            cached.record->inUse.store(false, std::memory_order_release);
+                        }
+                    }
+                }
+
+                std::vector<entry> entries;
+            };
+            thread_local thread_cache cache;
+
+            State* key = state.get();
+            for (auto& cached : cache.entries)
+            {
+                if (cached.key == key)
+                {
+                    return *cached.record;
+                }
+            }
+            std::erase_if(cache.entries, [](const typename thread_cache::entry& cached)
+                          { return cached.state.expired(); });
+            cache.entries.push_back({ key, weak_ptr<State>(state), state->acquireRecord() });
+            return *cache.entries.back().record;
+        }
+    } // namespace detail
+} // namespace usu
@@ -1,23 +1,76 @@
 #pragma once
+#include "access_policy.hpp"
+#include "allocator.hpp"
+#include "instrumentation.hpp"
+#include "relocation.hpp"
+#include "sampling.hpp"
 
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <source_location>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 
 namespace usu
 {
+    // Deleter used by unique_ptr unless another is given
     template <typename T>
+    struct default_delete
+    {
+        void operator()(T* ptr) const { delete ptr; }
+    };
+
+    template <typename T>
+    struct default_delete<T[]>
+    {
+        void operator()(T* ptr) const { delete[] ptr; }
+    };
+
+    // Deleter for arrays from make_unique_array and make_unique_for_overwrite.
+    // The storage may be over-aligned, so it remembers the length and alignment
+    // it was allocated with.
+    template <typename T>
+    class array_delete
+    {
+      public:
+        array_delete() :
+            count(0), alignment(alignof(T))
+        {
+        }
+        array_delete(std::size_t count, std::size_t alignment) :
+            count(count), alignment(alignment)
+        {
+        }
+
+        void operator()(T* ptr) const
+        {
+            detail::destroy_elements(ptr, count);
+            detail::pool_deallocate(ptr, count * sizeof(T), alignment);
+        }
+
+        std::size_t size() const { return count; }
+
+      private:
+        std::size_t count;
+        std::size_t alignment;
+    };
+
+    template <typename T, typename Deleter = default_delete<T>>
     class unique_ptr
     {
       public:
         // Constructors
         explicit unique_ptr(T* ptr = nullptr);
-        unique_ptr(unique_ptr<T>&& otherUnique) noexcept;
+        unique_ptr(T* ptr, const Deleter& deleter);
+        unique_ptr(unique_ptr<T, Deleter>&& otherUnique) noexcept;
 
         // Destructor
         ~unique_ptr();
 
         // Assignment Operators
-        unique_ptr<T>& operator=(unique_ptr<T>&& otherUnique) noexcept;
+        unique_ptr<T, Deleter>& operator=(unique_ptr<T, Deleter>&& otherUnique) noexcept;
 
         // Dereference Operators
         T& operator*();
@@ -31,129 +84,446 @@ namespace usu
         T* get() const { return rawPointer; }
         T* release();
         void reset(T* ptr = nullptr);
-        void swap(unique_ptr<T>& other) noexcept;
+        void swap(unique_ptr<T, Deleter>& other) noexcept;
+        Deleter& get_deleter() { return deleter; }
+        const Deleter& get_deleter() const { return deleter; }
 
         // Comparison Operators
-        bool operator==(const unique_ptr<T>& otherUnique) const;
-        bool operator!=(const unique_ptr<T>& otherUnique) const;
+        bool operator==(const unique_ptr<T, Deleter>& otherUnique) const;
+        bool operator!=(const unique_ptr<T, Deleter>& otherUnique) const;
 
       private:
+        void destroy() { destroy(rawPointer, deleter); }
+        // Destroys oldPointer's object; called only once this no longer holds it
+        static void destroy(T* oldPointer, Deleter& oldDeleter);
+
         T* rawPointer;
+        // Stateless deleters take no space, so the pointer stays one word wide
+        [[no_unique_address]] Deleter deleter;
     };
 
     // Constructor
-    template <typename T>
-    unique_ptr<T>::unique_ptr(T* ptr) :
-        rawPointer(ptr)
+    template <typename T, typename Deleter>
+    unique_ptr<T, Deleter>::unique_ptr(T* ptr) :
+        rawPointer(ptr), deleter()
     {
+        if (rawPointer)
+        {
+            detail::instrument<T>::allocated();
+        }
+    }
+
+    template <typename T, typename Deleter>
+    unique_ptr<T, Deleter>::unique_ptr(T* ptr, const Deleter& deleter) :
+        rawPointer(ptr), deleter(deleter)
+    {
+        if (rawPointer)
+        {
+            detail::instrument<T>::allocated();
+        }
     }
 
     // Move Constructor
-    template <typename T>
-    unique_ptr<T>::unique_ptr(unique_ptr<T>&& otherUnique) noexcept :
-        rawPointer(otherUnique.rawPointer)
+    template <typename T, typename Deleter>
+    unique_ptr<T, Deleter>::unique_ptr(unique_ptr<T, Deleter>&& otherUnique) noexcept :
+        rawPointer(otherUnique.rawPointer), deleter(std::move(otherUnique.deleter))
     {
+        if (rawPointer)
+        {
+            detail::instrument<T>::moved();
+        }
         otherUnique.rawPointer = nullptr;
     }
 
     // Destructor
-    template <typename T>
-    unique_ptr<T>::~unique_ptr()
+    template <typename T, typename Deleter>
+    unique_ptr<T, Deleter>::~unique_ptr()
     {
-        delete rawPointer;
+        destroy();
     }
 
     // Move Assignment Operator
-    template <typename T>
-    unique_ptr<T>& unique_ptr<T>::operator=(unique_ptr<T>&& otherUnique) noexcept
+    template <typename T, typename Deleter>
+    unique_ptr<T, Deleter>& unique_ptr<T, Deleter>::operator=(unique_ptr<T, Deleter>&& otherUnique) noexcept
     {
         if (this != &otherUnique)
         {
-            delete rawPointer;
-            rawPointer = otherUnique.rawPointer;
+            // Taken before the old object goes, which may own otherUnique
+            T* newPointer = otherUnique.rawPointer;
             otherUnique.rawPointer = nullptr;
+            Deleter newDeleter(std::move(otherUnique.deleter));
+
+            T* oldPointer = rawPointer;
+            Deleter oldDeleter(std::move(deleter));
+            rawPointer = newPointer;
+            deleter = std::move(newDeleter);
+            if (rawPointer)
+            {
+                detail::instrument<T>::moved();
+            }
+            destroy(oldPointer, oldDeleter);
         }
         return *this;
     }
 
     // Dereference Operator
-    template <typename T>
-    T& unique_ptr<T>::operator*()
+    template <typename T, typename Deleter>
+    T& unique_ptr<T, Deleter>::operator*()
     {
-        if (!rawPointer)
-        {
-            throw std::runtime_error("Attempting to dereference a null unique_ptr.");
-        }
+        default_access::require<std::runtime_error>(rawPointer != nullptr, "Attempting to dereference a null unique_ptr.");
         return *rawPointer;
     }
 
-    template <typename T>
-    const T& unique_ptr<T>::operator*() const
+    template <typename T, typename Deleter>
+    const T& unique_ptr<T, Deleter>::operator*() const
     {
-        if (!rawPointer)
-        {
-            throw std::runtime_error("Attempting to dereference a null unique_ptr.");
-        }
+        default_access::require<std::runtime_error>(rawPointer != nullptr, "Attempting to dereference a null unique_ptr.");
         return *rawPointer;
     }
 
     // Arrow Operator
-    template <typename T>
-    T* unique_ptr<T>::operator->()
+    template <typename T, typename Deleter>
+    T* unique_ptr<T, Deleter>::operator->()
     {
         return rawPointer;
     }
 
-    template <typename T>
-    const T* unique_ptr<T>::operator->() const
+    template <typename T, typename Deleter>
+    const T* unique_ptr<T, Deleter>::operator->() const
     {
         return rawPointer;
     }
 
     // Release
-    template <typename T>
-    T* unique_ptr<T>::release()
+    template <typename T, typename Deleter>
+    T* unique_ptr<T, Deleter>::release()
     {
+        if (rawPointer)
+        {
+            detail::instrument<T>::released();
+            detail::forget_sample(rawPointer);
+        }
         T* temp = rawPointer;
         rawPointer = nullptr;
         return temp;
     }
 
     // Reset
-    template <typename T>
-    void unique_ptr<T>::reset(T* ptr)
+    template <typename T, typename Deleter>
+    void unique_ptr<T, Deleter>::reset(T* ptr)
     {
         if (rawPointer != ptr)
         {
-            delete rawPointer;
+            // Destroyed last, in case the old object owns this pointer
+            T* oldPointer = rawPointer;
             rawPointer = ptr;
+            if (rawPointer)
+            {
+                detail::instrument<T>::allocated();
+            }
+            destroy(oldPointer, deleter);
         }
     }
 
     // Swap
-    template <typename T>
-    void unique_ptr<T>::swap(unique_ptr<T>& other) noexcept
+    template <typename T, typename Deleter>
+    void unique_ptr<T, Deleter>::swap(unique_ptr<T, Deleter>& other) noexcept
     {
         std::swap(rawPointer, other.rawPointer);
+        std::swap(deleter, other.deleter);
     }
 
     // Comparison Operators
-    template <typename T>
-    bool unique_ptr<T>::operator==(const unique_ptr<T>& otherUnique) const
+    template <typename T, typename Deleter>
+    bool unique_ptr<T, Deleter>::operator==(const unique_ptr<T, Deleter>& otherUnique) const
     {
         return this->get() == otherUnique.get();
     }
 
-    template <typename T>
-    bool unique_ptr<T>::operator!=(const unique_ptr<T>& otherUnique) const
+    template <typename T, typename Deleter>
+    bool unique_ptr<T, Deleter>::operator!=(const unique_ptr<T, Deleter>& otherUnique) const
     {
         return this->get() != otherUnique.get();
     }
 
-    // make_unique for single objects
+    // Hands the owned object to the deleter, which need not accept null
+    template <typename T, typename Deleter>
+    void unique_ptr<T, Deleter>::destroy(T* oldPointer, Deleter& oldDeleter)
+    {
+        if (oldPointer)
+        {
+            detail::instrument<T>::destroyed();
+            detail::forget_sample(oldPointer);
+            oldDeleter(oldPointer);
+        }
+    }
+
+    // Array unique pointer
+
+    template <typename T, typename Deleter>
+    class unique_ptr<T[], Deleter>
+    {
+      public:
+        // Constructors
+        explicit unique_ptr(T* ptr = nullptr);
+        unique_ptr(T* ptr, const Deleter& deleter);
+        unique_ptr(unique_ptr<T[], Deleter>&& otherUnique) noexcept;
+
+        // Destructor
+        ~unique_ptr();
+
+        // Assignment Operators
+        unique_ptr<T[], Deleter>& operator=(unique_ptr<T[], Deleter>&& otherUnique) noexcept;
+
+        // Subscript Operator
+        T& operator[](std::size_t index) const { return element<default_access>(index); }
+        template <typename Access>
+        T& element(std::size_t index) const;
+
+        // Utility Functions
+        T* get() const { return rawPointer; }
+        T* release();
+        void reset(T* ptr = nullptr);
+        void swap(unique_ptr<T[], Deleter>& other) noexcept;
+        Deleter& get_deleter() { return deleter; }
+        const Deleter& get_deleter() const { return deleter; }
+
+        // Comparison Operators
+        bool operator==(const unique_ptr<T[], Deleter>& otherUnique) const { return rawPointer == otherUnique.rawPointer; }
+        bool operator!=(const unique_ptr<T[], Deleter>& otherUnique) const { return rawPointer != otherUnique.rawPointer; }
+
+      private:
+        void destroy() { destroy(rawPointer, deleter); }
+        // Destroys oldPointer's object; called only once this no longer holds it
+        static void destroy(T* oldPointer, Deleter& oldDeleter);
+
+        T* rawPointer;
+        // Stateless deleters take no space, so the pointer stays one word wide
+        [[no_unique_address]] Deleter deleter;
+    };
+
+    // Constructor
+    template <typename T, typename Deleter>
+    unique_ptr<T[], Deleter>::unique_ptr(T* ptr) :
+        rawPointer(ptr), deleter()
+    {
+        if (rawPointer)
+        {
+            detail::instrument<T[]>::allocated();
+        }
+    }
+
+    template <typename T, typename Deleter>
+    unique_ptr<T[], Deleter>::unique_ptr(T* ptr, const Deleter& deleter) :
+        rawPointer(ptr), deleter(deleter)
+    {
+        if (rawPointer)
+        {
+            detail::instrument<T[]>::allocated();
+        }
+    }
+
+    // Move Constructor
+    template <typename T, typename Deleter>
+    unique_ptr<T[], Deleter>::unique_ptr(unique_ptr<T[], Deleter>&& otherUnique) noexcept :
+        rawPointer(otherUnique.rawPointer), deleter(std::move(otherUnique.deleter))
+    {
+        if (rawPointer)
+        {
+            detail::instrument<T[]>::moved();
+        }
+        otherUnique.rawPointer = nullptr;
+    }
+
+    // Destructor
+    template <typename T, typename Deleter>
+    unique_ptr<T[], Deleter>::~unique_ptr()
+    {
+        destroy();
+    }
+
+    // Move Assignment Operator
+    template <typename T, typename Deleter>
+    unique_ptr<T[], Deleter>& unique_ptr<T[], Deleter>::operator=(unique_ptr<T[], Deleter>&& otherUnique) noexcept
+    {
+        if (this != &otherUnique)
+        {
+            // Taken before the old object goes, which may own otherUnique
+            T* newPointer = otherUnique.rawPointer;
+            otherUnique.rawPointer = nullptr;
+            Deleter newDeleter(std::move(otherUnique.deleter));
+
+            T* oldPointer = rawPointer;
+            Deleter oldDeleter(std::move(deleter));
+            rawPointer = newPointer;
+            deleter = std::move(newDeleter);
+            if (rawPointer)
+            {
+                detail::instrument<T[]>::moved();
+            }
+            destroy(oldPointer, oldDeleter);
+        }
+        return *this;
+    }
+
+    // Element access. The length is not stored, so only null is checked.
+    template <typename T, typename Deleter>
+    template <typename Access>
+    T& unique_ptr<T[], Deleter>::element(std::size_t index) const
+    {
+        Access::template require<std::runtime_error>(rawPointer != nullptr, "Attempting to access elements of a null unique_ptr.");
+        return rawPointer[index];
+    }
+
+    // Release
+    template <typename T, typename Deleter>
+    T* unique_ptr<T[], Deleter>::release()
+    {
+        if (rawPointer)
+        {
+            detail::instrument<T[]>::released();
+        }
+        T* temp = rawPointer;
+        rawPointer = nullptr;
+        return temp;
+    }
+
+    // Reset
+    template <typename T, typename Deleter>
+    void unique_ptr<T[], Deleter>::reset(T* ptr)
+    {
+        if (rawPointer != ptr)
+        {
+            // Destroyed last, in case the old object owns this pointer
+            T* oldPointer = rawPointer;
+            rawPointer = ptr;
+            if (rawPointer)
+            {
+                detail::instrument<T[]>::allocated();
+            }
+            destroy(oldPointer, deleter);
+        }
+    }
+
+    // Swap
+    template <typename T, typename Deleter>
+    void unique_ptr<T[], Deleter>::swap(unique_ptr<T[], Deleter>& other) noexcept
+    {
+        std::swap(rawPointer, other.rawPointer);
+        std::swap(deleter, other.deleter);
+    }
+
+    template <typename T, typename Deleter>
+    void unique_ptr<T[], Deleter>::destroy(T* oldPointer, Deleter& oldDeleter)
+    {
+        if (oldPointer)
+        {
+            detail::instrument<T[]>::destroyed();
+            oldDeleter(oldPointer);
+        }
+    }
+
+    // make_unique for single objects. When the sampler takes one, it is filed
+    // under site; pass std::source_location::current() to name the line.
+    template <typename T, typename... Args>
+        requires(!std::is_array_v<T>)
+    unique_ptr<T> make_unique_at(std::source_location site, Args&&... args)
+    {
+        T* object = new T(std::forward<Args>(args)...);
+        if (detail::sampling_on()) [[unlikely]]
+        {
+            detail::sample_object<T>(object, site);
+        }
+        return unique_ptr<T>(object);
+    }
+
+    // make_unique for single objects; sampled ones are filed under an unknown site, by type
     template <typename T, typename... Args>
+        requires(!std::is_array_v<T> && !detail::leads_with_resource<Args...>)
     unique_ptr<T> make_unique(Args&&... args)
     {
-        return unique_ptr<T>(new T(std::forward<Args>(args)...));
+        return make_unique_at<T>(std::source_location(), std::forward<Args>(args)...);
+    }
+
+    // make_unique for arrays, with value-initialized elements
+    template <typename A>
+        requires std::is_unbounded_array_v<A>
+    unique_ptr<A> make_unique(std::size_t size)
+    {
+        return unique_ptr<A>(new std::remove_extent_t<A>[size]());
+    }
+
+    namespace detail
+    {
+        template <typename T, bool Overwrite>
+        unique_ptr<T[], array_delete<T>> allocate_unique_array(std::size_t size, std::size_t alignment)
+        {
+            alignment = array_alignment<T>(alignment);
+            std::size_t bytes = array_bytes<T>(size);
+            T* elements = static_cast<T*>(pool_allocate(bytes, alignment));
+            try
+            {
+                construct_elements<T, Overwrite>(elements, size);
+            }
+            catch (...)
+            {
+                pool_deallocate(elements, bytes, alignment);
+                throw;
+            }
+            return unique_ptr<T[], array_delete<T>>(elements, array_delete<T>(size, alignment));
+        }
+    } // namespace detail
+
+    // Array of value-initialized elements starting on an alignment-byte boundary
+    template <typename T>
+    unique_ptr<T[], array_delete<T>> make_unique_array(std::size_t size, std::size_t alignment = alignof(T))
+    {
+        return detail::allocate_unique_array<T, false>(size, alignment);
+    }
+
+    // Like make_unique_array, but trivial elements are left uninitialized
+    template <typename A>
+        requires std::is_unbounded_array_v<A>
+    unique_ptr<A, array_delete<std::remove_extent_t<A>>> make_unique_for_overwrite(std::size_t size, std::size_t alignment = alignof(std::remove_extent_t<A>))
+    {
+        return detail::allocate_unique_array<std::remove_extent_t<A>, true>(size, alignment);
+    }
+
+    // Allocates and constructs the object with a user allocator; the returned
+    // pointer frees it through a copy of the same allocator
+    template <typename T, typename Alloc, typename... Args>
+    auto allocate_unique(const Alloc& alloc, Args&&... args)
+    {
+        using object_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using traits = std::allocator_traits<object_alloc>;
+        object_alloc objectAlloc(alloc);
+        T* memory = traits::allocate(objectAlloc, 1);
+        try
+        {
+            traits::construct(objectAlloc, memory, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            traits::deallocate(objectAlloc, memory, 1);
+            throw;
+        }
+        return unique_ptr<T, allocator_delete<object_alloc>>(memory, allocator_delete<object_alloc>(objectAlloc));
+    }
+
+    // make_unique from a memory resource, which gets the memory back when the pointer is destroyed
+    template <typename T, typename... Args>
+    auto make_unique(std::pmr::memory_resource* resource, Args&&... args)
+    {
+        return allocate_unique<T>(std::pmr::polymorphic_allocator<T>(resource), std::forward<Args>(args)...);
     }
-} // namespace usu
\ No newline at end of file
+
+    // Relocatable whenever the deleter is
+    template <typename T, typename Deleter>
+    struct is_trivially_relocatable<unique_ptr<T, Deleter>> : is_trivially_relocatable<Deleter>
+    {
+    };
+
+    static_assert(sizeof(unique_ptr<int>) == sizeof(int*), "unique_ptr with a stateless deleter must be one pointer wide");
+    static_assert(sizeof(unique_ptr<int[]>) == sizeof(int*), "unique_ptr with a stateless deleter must be one pointer wide");
+    static_assert(sizeof(unique_ptr<int, allocator_delete<pool_allocator<int>>>) == sizeof(int*), "unique_ptr with a stateless deleter must be one pointer wide");
+} // namespace usu